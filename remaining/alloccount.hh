@@ -0,0 +1,16 @@
+#ifndef __ALLOCCOUNT_HH__
+#define __ALLOCCOUNT_HH__
+
+
+/*** Counting of heap allocations, for the benchmarks in the lab
+     directories (see symtab/symtabbench.cc and scan/scantest.cc). Linking
+     alloccount.cc into a program replaces the global operator new and
+     delete with versions that count the calls to new. The compiler itself
+     doesn't use it. ***/
+
+
+// Nr of calls to operator new since the program started.
+extern long nr_allocs;
+
+
+#endif
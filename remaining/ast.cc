@@ -9,7 +9,7 @@ int ast_node::indent_level = 0;
 bool ast_node::branches[10000];
 
 /* The superclass ast_node. */
-ast_node::ast_node(position_information *p) :
+ast_node::ast_node(position_information p) :
     pos(p)
 {
     tag = AST_NODE;
@@ -17,7 +17,7 @@ ast_node::ast_node(position_information *p) :
 
 
 /* The ast_statement class. */
-ast_statement::ast_statement(position_information *p) :
+ast_statement::ast_statement(position_information p) :
     ast_node(p)
 {
     tag = AST_STATEMENT;
@@ -26,8 +26,9 @@ ast_statement::ast_statement(position_information *p) :
 
 
 /* The ast_expression class. */
-ast_expression::ast_expression(position_information *p) :
-    ast_node(p)
+ast_expression::ast_expression(position_information p) :
+    ast_node(p),
+    checked_type(NULL_SYM)
 {
     tag = AST_EXPRESSION;
     // This will be changed later, during type checking.
@@ -35,17 +36,18 @@ ast_expression::ast_expression(position_information *p) :
     type = void_type;
 }
 
-ast_expression::ast_expression(position_information *p,
+ast_expression::ast_expression(position_information p,
                                sym_index s) :
     ast_node(p),
-    type(s)
+    type(s),
+    checked_type(NULL_SYM)
 {
     tag = AST_EXPRESSION;
 }
 
 
 /* The ast_binaryrelation class. They all return integer values. */
-ast_binaryrelation::ast_binaryrelation(position_information *p,
+ast_binaryrelation::ast_binaryrelation(position_information p,
                                        ast_expression *l,
                                        ast_expression *r) :
     ast_expression(p, integer_type),
@@ -58,7 +60,7 @@ ast_binaryrelation::ast_binaryrelation(position_information *p,
 
 /* The ast_binaryoperation class. The type of the node will be synthesized
    later, during type checking. See semantic.cc. */
-ast_binaryoperation::ast_binaryoperation(position_information *p,
+ast_binaryoperation::ast_binaryoperation(position_information p,
         ast_expression *l,
         ast_expression *r) :
     ast_expression(p),
@@ -70,13 +72,13 @@ ast_binaryoperation::ast_binaryoperation(position_information *p,
 
 
 /* The ast_lvalue class. */
-ast_lvalue::ast_lvalue(position_information *p) :
+ast_lvalue::ast_lvalue(position_information p) :
     ast_expression(p)
 {
     tag = AST_LVALUE;
 }
 
-ast_lvalue::ast_lvalue(position_information *p,
+ast_lvalue::ast_lvalue(position_information p,
                        sym_index s) :
     ast_expression(p, s)
 {
@@ -91,7 +93,7 @@ ast_lvalue::ast_lvalue(position_information *p,
  ***********************************************************/
 
 /* The ast_elsif class. */
-ast_elsif::ast_elsif(position_information *p,
+ast_elsif::ast_elsif(position_information p,
                      ast_expression *c,
                      ast_stmt_list *b) :
     ast_node(p),
@@ -102,71 +104,84 @@ ast_elsif::ast_elsif(position_information *p,
 }
 
 
+/* Grow the item array of a list node so that there is room for one more
+   item. The arrays are allocated in the block arena like the nodes
+   themselves, so the old array is simply abandoned. */
+template <class T>
+static T **grow_items(T **items, int nr_items, int *items_size)
+{
+    if (nr_items < *items_size) {
+        return items;
+    }
+    int new_size = *items_size == 0 ? 4 : *items_size * 2;
+    T **new_items = (T **) block_allocate(new_size * sizeof(T *));
+    for (int i = 0; i < nr_items; i++) {
+        new_items[i] = items[i];
+    }
+    *items_size = new_size;
+    return new_items;
+}
+
+
 /* The ast_expr_list class. Currently only used for parameter lists. */
-ast_expr_list::ast_expr_list(position_information *p,
-                             ast_expression *l) :
+ast_expr_list::ast_expr_list(position_information p,
+                             ast_expression *e) :
     ast_node(p),
-    last_expr(l)
+    exprs(NULL),
+    nr_exprs(0),
+    exprs_size(0)
 {
     tag = AST_EXPR_LIST;
-    preceding = NULL;
+    append(e);
 }
 
-ast_expr_list::ast_expr_list(position_information *p,
-                             ast_expression *l,
-                             ast_expr_list *prev) :
-    ast_node(p),
-    last_expr(l),
-    preceding(prev)
+void ast_expr_list::append(ast_expression *e)
 {
-    tag = AST_EXPR_LIST;
+    exprs = grow_items(exprs, nr_exprs, &exprs_size);
+    exprs[nr_exprs++] = e;
 }
 
 
 /* The ast_stmt_list class. */
-ast_stmt_list::ast_stmt_list(position_information *p,
-                             ast_statement *h) :
+ast_stmt_list::ast_stmt_list(position_information p,
+                             ast_statement *s) :
     ast_node(p),
-    last_stmt(h)
+    stmts(NULL),
+    nr_stmts(0),
+    stmts_size(0)
 {
     tag = AST_STMT_LIST;
-    preceding = NULL;
+    append(s);
 }
 
-ast_stmt_list::ast_stmt_list(position_information *p,
-                             ast_statement *h,
-                             ast_stmt_list *t) :
-    ast_node(p),
-    last_stmt(h),
-    preceding(t)
+void ast_stmt_list::append(ast_statement *s)
 {
-    tag = AST_STMT_LIST;
+    stmts = grow_items(stmts, nr_stmts, &stmts_size);
+    stmts[nr_stmts++] = s;
 }
 
 
 /* The ast_elsif_list class. */
-ast_elsif_list::ast_elsif_list(position_information *p,
-                               ast_elsif *h) :
+ast_elsif_list::ast_elsif_list(position_information p,
+                               ast_elsif *e) :
     ast_node(p),
-    last_elsif(h)
+    elsifs(NULL),
+    nr_elsifs(0),
+    elsifs_size(0)
 {
     tag = AST_ELSIF_LIST;
-    preceding = NULL;
+    append(e);
 }
 
-ast_elsif_list::ast_elsif_list(position_information *p,
-                               ast_elsif *h,
-                               ast_elsif_list *t) :
-    ast_node(p),
-    last_elsif(h),
-    preceding(t)
+void ast_elsif_list::append(ast_elsif *e)
 {
-    tag = AST_ELSIF_LIST;
+    elsifs = grow_items(elsifs, nr_elsifs, &elsifs_size);
+    elsifs[nr_elsifs++] = e;
 }
 
 
 /* The ast_procedurecall class. */
-ast_procedurecall::ast_procedurecall(position_information *p,
+ast_procedurecall::ast_procedurecall(position_information p,
                                      ast_id *i,
                                      ast_expr_list *par) :
     ast_statement(p),
@@ -178,7 +193,7 @@ ast_procedurecall::ast_procedurecall(position_information *p,
 
 
 /* The ast_assign class. */
-ast_assign::ast_assign(position_information *p,
+ast_assign::ast_assign(position_information p,
                        ast_lvalue *l,
                        ast_expression *r) :
     ast_statement(p),
@@ -190,7 +205,7 @@ ast_assign::ast_assign(position_information *p,
 
 
 /* The ast_while class. */
-ast_while::ast_while(position_information *p,
+ast_while::ast_while(position_information p,
                      ast_expression *c,
                      ast_stmt_list *b) :
     ast_statement(p),
@@ -202,7 +217,7 @@ ast_while::ast_while(position_information *p,
 
 
 /* The ast_if class. */
-ast_if::ast_if(position_information *p,
+ast_if::ast_if(position_information p,
                ast_expression *c,
                ast_stmt_list *b,
                ast_elsif_list *eil,
@@ -218,14 +233,14 @@ ast_if::ast_if(position_information *p,
 
 
 /* The ast_return class. */
-ast_return::ast_return(position_information *p) :
+ast_return::ast_return(position_information p) :
     ast_statement(p)
 {
     tag = AST_RETURN;
     value = NULL;
 }
 
-ast_return::ast_return(position_information *p,
+ast_return::ast_return(position_information p,
                        ast_expression *v) :
     ast_statement(p),
     value(v)
@@ -235,7 +250,7 @@ ast_return::ast_return(position_information *p,
 
 
 /* The ast_functioncall class. */
-ast_functioncall::ast_functioncall(position_information *p,
+ast_functioncall::ast_functioncall(position_information p,
                                    ast_id *i,
                                    ast_expr_list *par) :
     ast_expression(p, i->type),
@@ -250,7 +265,7 @@ ast_functioncall::ast_functioncall(position_information *p,
 /*** Unary operator nodes: ast_uminus, ast_not. */
 
 /* The ast_uminus class. */
-ast_uminus::ast_uminus(position_information *p,
+ast_uminus::ast_uminus(position_information p,
                        ast_expression *e) :
     ast_expression(p, e->type),
     expr(e)
@@ -259,7 +274,7 @@ ast_uminus::ast_uminus(position_information *p,
 }
 
 /* The ast_not class. Logical negation. */
-ast_not::ast_not(position_information *p,
+ast_not::ast_not(position_information p,
                  ast_expression *e) :
     ast_expression(p, integer_type),
     expr(e)
@@ -272,16 +287,16 @@ ast_not::ast_not(position_information *p,
 /*** Classes derived from ast_binaryrelation. ***/
 
 /* The ast_equal class. */
-ast_equal::ast_equal(position_information *p,
+ast_equal::ast_equal(position_information p,
                      ast_expression *l,
                      ast_expression *r) :
     ast_binaryrelation(p, l, r)
 {
-    tag = AST_BINARYRELATION;
+    tag = AST_EQUAL;
 }
 
 /* The ast_notequal class. */
-ast_notequal::ast_notequal(position_information *p,
+ast_notequal::ast_notequal(position_information p,
                            ast_expression *l,
                            ast_expression *r) :
     ast_binaryrelation(p, l, r)
@@ -291,7 +306,7 @@ ast_notequal::ast_notequal(position_information *p,
 
 
 /* The ast_lessthan class. */
-ast_lessthan::ast_lessthan(position_information *p,
+ast_lessthan::ast_lessthan(position_information p,
                            ast_expression *l,
                            ast_expression *r) :
     ast_binaryrelation(p, l, r)
@@ -300,7 +315,7 @@ ast_lessthan::ast_lessthan(position_information *p,
 }
 
 /* The ast_greaterthan class. */
-ast_greaterthan::ast_greaterthan(position_information *p,
+ast_greaterthan::ast_greaterthan(position_information p,
                                  ast_expression *l,
                                  ast_expression *r) :
     ast_binaryrelation(p, l, r)
@@ -313,7 +328,7 @@ ast_greaterthan::ast_greaterthan(position_information *p,
 /*** Classes derived from ast_binaryoperation. ***/
 
 /* The ast_add class. */
-ast_add::ast_add(position_information *p,
+ast_add::ast_add(position_information p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -322,7 +337,7 @@ ast_add::ast_add(position_information *p,
 }
 
 /* The ast_sub class. */
-ast_sub::ast_sub(position_information *p,
+ast_sub::ast_sub(position_information p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -331,7 +346,7 @@ ast_sub::ast_sub(position_information *p,
 }
 
 /* The ast_or class. */
-ast_or::ast_or(position_information *p,
+ast_or::ast_or(position_information p,
                ast_expression *l,
                ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -340,7 +355,7 @@ ast_or::ast_or(position_information *p,
 }
 
 /* The ast_and class. */
-ast_and::ast_and(position_information *p,
+ast_and::ast_and(position_information p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -349,7 +364,7 @@ ast_and::ast_and(position_information *p,
 }
 
 /* The ast_mult class. */
-ast_mult::ast_mult(position_information *p,
+ast_mult::ast_mult(position_information p,
                    ast_expression *l,
                    ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -358,7 +373,7 @@ ast_mult::ast_mult(position_information *p,
 }
 
 /* The ast_divide class. */
-ast_divide::ast_divide(position_information *p,
+ast_divide::ast_divide(position_information p,
                        ast_expression *l,
                        ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -367,7 +382,7 @@ ast_divide::ast_divide(position_information *p,
 }
 
 /* The ast_idiv class. */
-ast_idiv::ast_idiv(position_information *p,
+ast_idiv::ast_idiv(position_information p,
                    ast_expression *l,
                    ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -376,7 +391,7 @@ ast_idiv::ast_idiv(position_information *p,
 }
 
 /* The ast_mod class. */
-ast_mod::ast_mod(position_information *p,
+ast_mod::ast_mod(position_information p,
                  ast_expression *l,
                  ast_expression *r) :
     ast_binaryoperation(p, l, r)
@@ -389,7 +404,7 @@ ast_mod::ast_mod(position_information *p,
 /*** Nodes that function as lvalues: ast_id and ast_indexed ***/
 
 /* The ast_id class. */
-ast_id::ast_id(position_information *p,
+ast_id::ast_id(position_information p,
                sym_index s) :
     ast_lvalue(p),
     sym_p(s)
@@ -399,7 +414,7 @@ ast_id::ast_id(position_information *p,
 
 
 /* The ast_indexed class. */
-ast_indexed::ast_indexed(position_information *p,
+ast_indexed::ast_indexed(position_information p,
                          ast_id *i,
                          ast_expression *n) :
     ast_lvalue(p),
@@ -413,7 +428,7 @@ ast_indexed::ast_indexed(position_information *p,
 /*** Nodes for representing integer/real constants, '5' or '2.5', or so. */
 
 /* The ast_integer class. */
-ast_integer::ast_integer(position_information *p,
+ast_integer::ast_integer(position_information p,
                          long i) :
     ast_expression(p, integer_type),
     value(i)
@@ -423,7 +438,7 @@ ast_integer::ast_integer(position_information *p,
 
 
 /* The ast_real class. Note: the value is stored in ieee 64-bit format. */
-ast_real::ast_real(position_information *p,
+ast_real::ast_real(position_information p,
                    double r) :
     ast_expression(p, real_type),
     value(r)
@@ -434,7 +449,7 @@ ast_real::ast_real(position_information *p,
 
 /* The ast_cast class. Used to convert integers to reals. Note: the value is
    stored in ieee 64-bit format. Cast nodes are always of real type. */
-ast_cast::ast_cast(position_information *p,
+ast_cast::ast_cast(position_information p,
                    ast_expression *n) :
     ast_expression(p, real_type),
     expr(n)
@@ -444,7 +459,7 @@ ast_cast::ast_cast(position_information *p,
 
 
 /* The ast_functionhead class. */
-ast_functionhead::ast_functionhead(position_information *p,
+ast_functionhead::ast_functionhead(position_information p,
                                    sym_index s) :
     ast_node(p),
     sym_p(s)
@@ -454,7 +469,7 @@ ast_functionhead::ast_functionhead(position_information *p,
 
 
 /* The ast_procedurehead class. */
-ast_procedurehead::ast_procedurehead(position_information *p,
+ast_procedurehead::ast_procedurehead(position_information p,
                                      sym_index s) :
     ast_node(p),
     sym_p(s)
@@ -595,43 +610,40 @@ void ast_elsif::print(ostream &o)
 }
 
 
+/* The list nodes are printed as if they still were chains of nodes, each
+   with its preceding items as first child and its last item as second
+   child. First open one level per item, from the last item inwards, then
+   close them again printing the items in source order. */
+template <class T>
+void ast_node::print_list(ostream &o, const char *header, T **items, int nr)
+{
+    for (int i = nr - 1; i >= 0; i--) {
+        o << header;
+        begin_child(o);
+    }
+    o << "NULL" << flush;
+    for (int i = 0; i < nr; i++) {
+        o << endl;
+        end_child(o);
+        last_child(o);
+        o << items[i];
+        end_child(o);
+    }
+}
+
 void ast_expr_list::print(ostream &o)
 {
-    o << "Expression list (preceding, last_expr)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_expr << endl;
-    end_child(o);
-    last_child(o);
-    o << last_expr;
-    // o << preceding;
-    end_child(o);
+    print_list(o, "Expression list (preceding, last_expr)\n", exprs, nr_exprs);
 }
 
 void ast_stmt_list::print(ostream &o)
 {
-    o << "Statement list (preceding, last_stmt)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_stmt << endl;
-    end_child(o);
-    last_child(o);
-    // o << preceding;
-    o << last_stmt;
-    end_child(o);
+    print_list(o, "Statement list (preceding, last_stmt)\n", stmts, nr_stmts);
 }
 
 void ast_elsif_list::print(ostream &o)
 {
-    o << "Elsif list (preceding, last_elsif)\n";
-    begin_child(o);
-    o << preceding << endl;
-    // o << last_elsif << endl;
-    end_child(o);
-    last_child(o);
-    // o << preceding;
-    o << last_elsif;
-    end_child(o);
+    print_list(o, "Elsif list (preceding, last_elsif)\n", elsifs, nr_elsifs);
 }
 
 
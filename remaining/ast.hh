@@ -169,6 +169,11 @@ protected:
 
     void indent_less();
 
+    // Prints the items of a list node as the left-recursive chain the
+    // grammar describes, without recursing. See ast.cc.
+    template <class T>
+    void print_list(ostream &, const char *, T **, int);
+
     void begin_child(ostream &);
 
     void end_child(ostream &);
@@ -181,14 +186,22 @@ protected:
 
 public:
     // Holds line and column number for this node.
-    position_information *pos;
+    position_information pos;
 
     // Describes what kind of node this is. We need to be able to check this
     // in a convenient way during AST optimization.
     ast_node_type tag;
 
     // Constructor.
-    ast_node(position_information *);
+    ast_node(position_information);
+
+    // AST nodes are allocated from the arena of the block they belong to,
+    // and are all freed when the block has been compiled. See parser.y.
+    static void *operator new(size_t size) {
+        return block_allocate(size);
+    }
+
+    static void operator delete(void *) {}
 
     // Perform type checking. See semantic.cc for the method bodies.
     // Note that it's an error to call type_check in this class. It should
@@ -200,6 +213,11 @@ public:
     // class. It should only be called in the concrete AST nodes.
     virtual void optimize();
 
+    // Used by the optimizer to find out which variables are assigned in a
+    // block. Does nothing except in statements and statement lists, since
+    // expressions can't assign variables of the block itself.
+    virtual void count_assignments();
+
     // Generate quads. See quads.cc for the method bodies. Like type checking,
     // generate_quads should only be called in concrete AST nodes. See below.
     virtual sym_index generate_quads(quad_list &) = 0;
@@ -217,7 +235,7 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_statement(position_information *);
+    ast_statement(position_information);
 
     // It's an error if these methods are called. See the derived classes.
     virtual sym_index type_check();
@@ -239,13 +257,22 @@ public:
     sym_index type;
 
     // Constructors.
-    ast_expression(position_information *);
+    ast_expression(position_information);
 
-    ast_expression(position_information *, sym_index);
+    ast_expression(position_information, sym_index);
 
-    // It's an error if these methods are called. See the derived classes.
+    // The type found by the first call to type_check(), or NULL_SYM if the
+    // expression hasn't been type checked yet.
+    sym_index checked_type;
+
+    // Type check the expression the first time it is called, and return the
+    // cached type after that. The derived classes define compute_type()
+    // instead of overriding this, so that no expression is checked twice.
     virtual sym_index type_check();
 
+    // It's an error if these methods are called. See the derived classes.
+    virtual sym_index compute_type();
+
     virtual void optimize();
 
     virtual sym_index generate_quads(quad_list &) = 0;
@@ -299,12 +326,12 @@ public:
     ast_expression *right;
 
     // Constructor.
-    ast_binaryrelation(position_information *,
+    ast_binaryrelation(position_information,
                        ast_expression *,
                        ast_expression *);
 
     // It's an error if this method is called. See the derived classes.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     virtual void optimize();
 
@@ -329,12 +356,12 @@ public:
     ast_expression *right;
 
     // Constructor.
-    ast_binaryoperation(position_information *,
+    ast_binaryoperation(position_information,
                         ast_expression *,
                         ast_expression *);
 
     // It's an error if these methods are called. See the derived classes.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     virtual void optimize();
 
@@ -357,12 +384,12 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructors.
-    ast_lvalue(position_information *);
+    ast_lvalue(position_information);
 
-    ast_lvalue(position_information *, sym_index);
+    ast_lvalue(position_information, sym_index);
 
     // It's an error if this method is called. See the derived classes.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     virtual void optimize();
 
@@ -392,7 +419,7 @@ public:
     ast_stmt_list *body;
 
     // Constructor.
-    ast_elsif(position_information *, ast_expression *, ast_stmt_list *);
+    ast_elsif(position_information, ast_expression *, ast_stmt_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -400,6 +427,9 @@ public:
     // AST optimization.
     virtual void optimize();
 
+    // Find the assigned variables.
+    virtual void count_assignments();
+
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 
@@ -409,23 +439,26 @@ public:
 
 
 /* Contains a list of expressions. Currently only used for parameter lists.
-   Note: The parameters will be stored in reverse order! This is due to how the
-         grammar is written, it's easiest this way. */
+   The expressions are stored in source order in a flat array, which is grown
+   as the parser appends to it. Passes walk the array with a loop instead of
+   recursing, so long lists don't eat stack. */
 class ast_expr_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
 public:
-    // Points to the last (last added) expression in the list.
-    ast_expression *last_expr;
+    // The expressions, first one at index 0.
+    ast_expression **exprs;
 
-    // Points to a list of the preceding expressions.
-    ast_expr_list *preceding;
+    // Nr of expressions in the list, and room allocated for them.
+    int nr_exprs;
+    int exprs_size;
 
-    // Constructors.
-    ast_expr_list(position_information *, ast_expression *);
+    // Constructor.
+    ast_expr_list(position_information, ast_expression *);
 
-    ast_expr_list(position_information *, ast_expression *, ast_expr_list *);
+    // Add an expression to the end of the list.
+    void append(ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -443,22 +476,24 @@ public:
 
 
 
-/* Contains a list of statements. */
+/* Contains a list of statements, stored like the expression list above. */
 class ast_stmt_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
 public:
-    // Points to the last statement in the list.
-    ast_statement *last_stmt;
+    // The statements, first one at index 0.
+    ast_statement **stmts;
 
-    // Points to a list of the preceding statements.
-    ast_stmt_list *preceding;
+    // Nr of statements in the list, and room allocated for them.
+    int nr_stmts;
+    int stmts_size;
 
-    // Constructors.
-    ast_stmt_list(position_information *, ast_statement *);
+    // Constructor.
+    ast_stmt_list(position_information, ast_statement *);
 
-    ast_stmt_list(position_information *, ast_statement *, ast_stmt_list *);
+    // Add a statement to the end of the list.
+    void append(ast_statement *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -466,28 +501,33 @@ public:
     // AST optimization.
     virtual void optimize();
 
+    // Find the assigned variables.
+    virtual void count_assignments();
+
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 };
 
 
 
-/* Contains a list of elsif clauses. */
+/* Contains a list of elsif clauses, stored like the expression list above. */
 class ast_elsif_list : public ast_node
 {
 protected:
     virtual void print(ostream &);
 public:
-    // Points to the last elsif clause in the list.
-    ast_elsif *last_elsif;
+    // The elsif clauses, first one at index 0.
+    ast_elsif **elsifs;
 
-    // Points to a list of the preceding elsif clauses.
-    ast_elsif_list *preceding;
+    // Nr of elsif clauses in the list, and room allocated for them.
+    int nr_elsifs;
+    int elsifs_size;
 
-    // Constructors.
-    ast_elsif_list(position_information *, ast_elsif *);
+    // Constructor.
+    ast_elsif_list(position_information, ast_elsif *);
 
-    ast_elsif_list(position_information *, ast_elsif *, ast_elsif_list *);
+    // Add an elsif clause to the end of the list.
+    void append(ast_elsif *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -495,6 +535,9 @@ public:
     // AST optimization.
     virtual void optimize();
 
+    // Find the assigned variables.
+    virtual void count_assignments();
+
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 
@@ -514,7 +557,7 @@ public:
     sym_index sym_p;
 
     // Constructor.
-    ast_functionhead(position_information *, sym_index);
+    ast_functionhead(position_information, sym_index);
 
     // Only here since we're using abstract virtual methods in ast_node.
     virtual void optimize();
@@ -539,7 +582,7 @@ public:
     sym_index sym_p;
 
     // Constructor.
-    ast_procedurehead(position_information *, sym_index);
+    ast_procedurehead(position_information, sym_index);
 
     // Only here since we're using abstract virtual methods in ast_node.
     virtual void optimize();
@@ -568,7 +611,7 @@ public:
     ast_expr_list *parameter_list;
 
     // Constructor.
-    ast_procedurecall(position_information *, ast_id *, ast_expr_list *);
+    ast_procedurecall(position_information, ast_id *, ast_expr_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -595,7 +638,7 @@ public:
     ast_expression *rhs;
 
     // Constructor.
-    ast_assign(position_information *, ast_lvalue *, ast_expression *);
+    ast_assign(position_information, ast_lvalue *, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -603,6 +646,9 @@ public:
     // AST optimization.
     virtual void optimize();
 
+    // Find the assigned variables.
+    virtual void count_assignments();
+
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 };
@@ -622,7 +668,7 @@ public:
     ast_stmt_list *body;
 
     // Constructor.
-    ast_while(position_information *, ast_expression *, ast_stmt_list *);
+    ast_while(position_information, ast_expression *, ast_stmt_list *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -630,6 +676,9 @@ public:
     // AST optimization.
     virtual void optimize();
 
+    // Find the assigned variables.
+    virtual void count_assignments();
+
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 };
@@ -655,7 +704,7 @@ public:
     ast_stmt_list *else_body;
 
     // Constructor.
-    ast_if(position_information *,
+    ast_if(position_information,
            ast_expression *,
            ast_stmt_list *,
            ast_elsif_list *,
@@ -667,6 +716,9 @@ public:
     // AST optimization.
     virtual void optimize();
 
+    // Find the assigned variables.
+    virtual void count_assignments();
+
     // Quad generation.
     virtual sym_index generate_quads(quad_list &);
 };
@@ -684,10 +736,10 @@ public:
     ast_expression *value;
 
     // Constructor for no return value.
-    ast_return(position_information *);
+    ast_return(position_information);
 
     // Constructor with a return value.
-    ast_return(position_information *, ast_expression *);
+    ast_return(position_information, ast_expression *);
 
     // Perform type checking.
     virtual sym_index type_check();
@@ -716,10 +768,10 @@ public:
     ast_expr_list *parameter_list;
 
     // Constructor.
-    ast_functioncall(position_information *, ast_id *, ast_expr_list *);
+    ast_functioncall(position_information, ast_id *, ast_expr_list *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -740,10 +792,10 @@ public:
     ast_expression *expr;
 
     // Constructor.
-    ast_uminus(position_information *, ast_expression *);
+    ast_uminus(position_information, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -763,10 +815,10 @@ public:
     ast_expression *expr;
 
     // Constructor.
-    ast_not(position_information *, ast_expression *);
+    ast_not(position_information, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -786,10 +838,10 @@ public:
     long value;
 
     // Constructor.
-    ast_integer(position_information *, long);
+    ast_integer(position_information, long);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -814,10 +866,10 @@ public:
     double value;
 
     // Constructor.
-    ast_real(position_information *, double);
+    ast_real(position_information, double);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -844,7 +896,7 @@ public:
     ast_expression *expr;
 
     // Constructor.
-    ast_cast(position_information *, ast_expression *);
+    ast_cast(position_information, ast_expression *);
 
     // AST optimization.
     virtual void optimize();
@@ -869,10 +921,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_equal(position_information *, ast_expression *, ast_expression *);
+    ast_equal(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -889,10 +941,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_notequal(position_information *, ast_expression *, ast_expression *);
+    ast_notequal(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -909,10 +961,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_lessthan(position_information *, ast_expression *, ast_expression *);
+    ast_lessthan(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -929,10 +981,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_greaterthan(position_information *, ast_expression *, ast_expression *);
+    ast_greaterthan(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -953,10 +1005,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_add(position_information *, ast_expression *, ast_expression *);
+    ast_add(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -978,10 +1030,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_sub(position_information *, ast_expression *, ast_expression *);
+    ast_sub(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1003,10 +1055,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_or(position_information *, ast_expression *, ast_expression *);
+    ast_or(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1028,10 +1080,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_and(position_information *, ast_expression *, ast_expression *);
+    ast_and(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1053,10 +1105,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_mult(position_information *, ast_expression *, ast_expression *);
+    ast_mult(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1078,10 +1130,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_divide(position_information *, ast_expression *, ast_expression *);
+    ast_divide(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1103,10 +1155,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_idiv(position_information *, ast_expression *, ast_expression *);
+    ast_idiv(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1128,10 +1180,10 @@ protected:
     virtual void print(ostream &);
 public:
     // Constructor.
-    ast_mod(position_information *, ast_expression *, ast_expression *);
+    ast_mod(position_information, ast_expression *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1158,12 +1210,12 @@ public:
     sym_index sym_p;
 
     // Constructors.
-    ast_id(position_information *);
+    ast_id(position_information);
 
-    ast_id(position_information *, sym_index);
+    ast_id(position_information, sym_index);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
@@ -1194,10 +1246,10 @@ public:
     ast_expression *index;
 
     // Constructor.
-    ast_indexed(position_information *, ast_id *, ast_expression *);
+    ast_indexed(position_information, ast_id *, ast_expression *);
 
     // Perform type checking.
-    virtual sym_index type_check();
+    virtual sym_index compute_type();
 
     // AST optimization.
     virtual void optimize();
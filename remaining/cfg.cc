@@ -0,0 +1,1244 @@
+#include <iostream>
+#include <iomanip>
+#include <string.h>
+#include <time.h>
+
+#include "symtab.hh"
+#include "quads.hh"
+#include "cfg.hh"
+
+using namespace std;
+
+
+/*** Quad operands. ***/
+
+/* Return the variable a quad writes, or NULL_SYM. Stores write memory, not
+   a variable, and a procedure call has no result. */
+sym_index quad_result(quadruple *q)
+{
+    switch (q->op_code) {
+    case q_rstore:
+    case q_istore:
+    case q_rreturn:
+    case q_ireturn:
+    case q_bounds:
+    case q_jmp:
+    case q_jmpf:
+    case q_param:
+    case q_labl:
+    case q_nop:
+        return NULL_SYM;
+    default:
+        return q->sym3;
+    }
+}
+
+
+/* Store pointers to the fields of a quad holding the symbols it reads in
+   refs, and return how many there are. The array of an index quad is not a
+   value, so only the index is returned. */
+int quad_operand_refs(quadruple *q, sym_index **refs)
+{
+    switch (q->op_code) {
+    case q_inot:
+    case q_ruminus:
+    case q_iuminus:
+    case q_ishl:
+    case q_isar:
+    case q_iand_mask:
+    case q_rassign:
+    case q_iassign:
+    case q_itor:
+    case q_param:
+    case q_bounds:
+        refs[0] = &q->sym1;
+        return 1;
+    case q_rplus:
+    case q_iplus:
+    case q_rminus:
+    case q_iminus:
+    case q_ior:
+    case q_iand:
+    case q_rmult:
+    case q_imult:
+    case q_rdivide:
+    case q_idivide:
+    case q_imod:
+    case q_req:
+    case q_ieq:
+    case q_rne:
+    case q_ine:
+    case q_rlt:
+    case q_ilt:
+    case q_rgt:
+    case q_igt:
+        refs[0] = &q->sym1;
+        refs[1] = &q->sym2;
+        return 2;
+    case q_rstore:
+    case q_istore:
+        refs[0] = &q->sym1;
+        refs[1] = &q->sym3;
+        return 2;
+    case q_rreturn:
+    case q_ireturn:
+    case q_lindex:
+    case q_rrindex:
+    case q_irindex:
+    case q_jmpf:
+        refs[0] = &q->sym2;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+
+/* Store the symbols a quad reads in ops and return how many there are. */
+int quad_operands(quadruple *q, sym_index *ops)
+{
+    sym_index *refs[2];
+    int nr_ops = quad_operand_refs(q, refs);
+    for (int i = 0; i < nr_ops; i++) {
+        ops[i] = *refs[i];
+    }
+    return nr_ops;
+}
+
+
+/* The quads computing a value from their operands and nothing else. The
+   array reads also depend on memory, which stores and calls change. A
+   bounds check computes nothing, but it may trap. */
+bool is_pure_quad(quadruple *q)
+{
+    switch (q->op_code) {
+    case q_rstore:
+    case q_istore:
+    case q_bounds:
+    case q_rassign:
+    case q_iassign:
+    case q_call:
+    case q_rreturn:
+    case q_ireturn:
+    case q_jmp:
+    case q_jmpf:
+    case q_param:
+    case q_labl:
+    case q_nop:
+        return false;
+    default:
+        return true;
+    }
+}
+
+
+/* Returns true if the two operands of a quad can be swapped. */
+bool is_commutative(quad_op_type op)
+{
+    switch (op) {
+    case q_rplus:
+    case q_iplus:
+    case q_ior:
+    case q_iand:
+    case q_rmult:
+    case q_imult:
+    case q_req:
+    case q_ieq:
+    case q_rne:
+    case q_ine:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/*** Bit vectors. ***/
+
+bit_vector::bit_vector() :
+    words(NULL),
+    nr_words(0),
+    nr_bits(0)
+{
+}
+
+bit_vector::~bit_vector()
+{
+    delete[] words;
+}
+
+void bit_vector::resize(int bits)
+{
+    delete[] words;
+    nr_bits = bits;
+    nr_words = (bits + 63) / 64;
+    words = new unsigned long[nr_words > 0 ? nr_words : 1];
+    clear();
+}
+
+void bit_vector::clear()
+{
+    memset(words, 0, nr_words * sizeof(unsigned long));
+}
+
+/* Set all bits. The bits past the end of the last word are kept cleared so
+   that equals() can compare whole words. */
+void bit_vector::fill()
+{
+    memset(words, 0xff, nr_words * sizeof(unsigned long));
+    if (nr_bits % 64 != 0) {
+        words[nr_words - 1] = (1UL << (nr_bits % 64)) - 1;
+    }
+}
+
+void bit_vector::copy(const bit_vector &other)
+{
+    memcpy(words, other.words, nr_words * sizeof(unsigned long));
+}
+
+bool bit_vector::equals(const bit_vector &other) const
+{
+    return memcmp(words, other.words, nr_words * sizeof(unsigned long)) == 0;
+}
+
+void bit_vector::unite(const bit_vector &other)
+{
+    for (int i = 0; i < nr_words; i++) {
+        words[i] |= other.words[i];
+    }
+}
+
+void bit_vector::intersect(const bit_vector &other)
+{
+    for (int i = 0; i < nr_words; i++) {
+        words[i] &= other.words[i];
+    }
+}
+
+void bit_vector::subtract(const bit_vector &other)
+{
+    for (int i = 0; i < nr_words; i++) {
+        words[i] &= ~other.words[i];
+    }
+}
+
+
+/*** Basic blocks. ***/
+
+basic_block::basic_block(int n) :
+    nr(n),
+    nr_quads(0),
+    quads_size(8),
+    nr_succ(0),
+    nr_preds(0),
+    preds_size(2)
+{
+    quads = new quadruple*[quads_size];
+    preds = new int[preds_size];
+}
+
+basic_block::~basic_block()
+{
+    delete[] quads;
+    delete[] preds;
+}
+
+void basic_block::append_quad(quadruple *q)
+{
+    if (nr_quads == quads_size) {
+        quadruple **old_quads = quads;
+        quads = new quadruple*[quads_size * 2];
+        memcpy(quads, old_quads, quads_size * sizeof(quadruple *));
+        delete[] old_quads;
+        quads_size *= 2;
+    }
+    quads[nr_quads++] = q;
+}
+
+void basic_block::add_pred(int p)
+{
+    if (nr_preds == preds_size) {
+        int *old_preds = preds;
+        preds = new int[preds_size * 2];
+        memcpy(preds, old_preds, preds_size * sizeof(int));
+        delete[] old_preds;
+        preds_size *= 2;
+    }
+    preds[nr_preds++] = p;
+}
+
+
+/*** The control flow graph. ***/
+
+int control_flow_graph::var_slot(sym_index sym_p)
+{
+    return (unsigned long) sym_p * 2654435761UL & (var_table_size - 1);
+}
+
+
+/* Give a variable or parameter the next variable nr, unless it already has
+   one. */
+void control_flow_graph::number_variable(sym_index sym_p)
+{
+    if (sym_p == NULL_SYM) {
+        return;
+    }
+    sym_type tag = sym_tab->get_symbol_tag(sym_p);
+    if (tag != SYM_VAR && tag != SYM_PARAM) {
+        return;
+    }
+    if (var_nr(sym_p) >= 0) {
+        return;
+    }
+
+    if (nr_vars == vars_size) {
+        sym_index *old_vars = vars;
+        vars = new sym_index[vars_size * 2];
+        memcpy(vars, old_vars, vars_size * sizeof(sym_index));
+        delete[] old_vars;
+        vars_size *= 2;
+    }
+
+    // Keep the hash table at most half full.
+    if (nr_vars * 2 >= var_table_size) {
+        delete[] var_table;
+        var_table_size *= 2;
+        var_table = new int[var_table_size];
+        memset(var_table, 0xff, var_table_size * sizeof(int));
+        for (int v = 0; v < nr_vars; v++) {
+            int i = var_slot(vars[v]);
+            while (var_table[i] >= 0) {
+                i = (i + 1) & (var_table_size - 1);
+            }
+            var_table[i] = v;
+        }
+    }
+
+    int i = var_slot(sym_p);
+    while (var_table[i] >= 0) {
+        i = (i + 1) & (var_table_size - 1);
+    }
+    var_table[i] = nr_vars;
+    vars[nr_vars++] = sym_p;
+}
+
+
+/* Return the nr of a variable, or -1 for symbols that aren't variables. */
+int control_flow_graph::var_nr(sym_index sym_p)
+{
+    int i = var_slot(sym_p);
+    while (var_table[i] >= 0) {
+        if (vars[var_table[i]] == sym_p) {
+            return var_table[i];
+        }
+        i = (i + 1) & (var_table_size - 1);
+    }
+    return -1;
+}
+
+
+/* Split a quad list into basic blocks. A label starts a new block, and a
+   jump or a return ends one. */
+control_flow_graph::control_flow_graph(quad_list *q_list) :
+    var_table_size(32),
+    nr_blocks(0),
+    blocks_size(16),
+    last_label(q_list->last_label),
+    order(NULL),
+    nr_reachable(0),
+    rpo_nr(NULL),
+    idom(NULL),
+    loops(NULL),
+    nr_loops(0),
+    nr_vars(0),
+    vars_size(16)
+{
+    blocks = new basic_block*[blocks_size];
+    vars = new sym_index[vars_size];
+    var_table = new int[var_table_size];
+    memset(var_table, 0xff, var_table_size * sizeof(int));
+
+    quad_list_iterator it(q_list);
+    basic_block *current = NULL;
+    for (quadruple *q = it.get_current(); q != NULL; q = it.get_next()) {
+        if (current == NULL ||
+            (q->op_code == q_labl && current->nr_quads > 0)) {
+            if (nr_blocks == blocks_size) {
+                basic_block **old_blocks = blocks;
+                blocks = new basic_block*[blocks_size * 2];
+                memcpy(blocks, old_blocks,
+                       blocks_size * sizeof(basic_block *));
+                delete[] old_blocks;
+                blocks_size *= 2;
+            }
+            current = new basic_block(nr_blocks);
+            blocks[nr_blocks++] = current;
+        }
+        current->append_quad(q);
+
+        sym_index ops[2];
+        int nr_ops = quad_operands(q, ops);
+        for (int i = 0; i < nr_ops; i++) {
+            number_variable(ops[i]);
+        }
+        number_variable(quad_result(q));
+
+        switch (q->op_code) {
+        case q_jmp:
+        case q_jmpf:
+        case q_rreturn:
+        case q_ireturn:
+            current = NULL;
+            break;
+        default:
+            break;
+        }
+    }
+
+    block_level local_level =
+        sym_tab->get_symbol_level(sym_tab->current_environment()) + 1;
+    named.resize(nr_vars);
+    nonlocal.resize(nr_vars);
+    for (int v = 0; v < nr_vars; v++) {
+        // Temporaries are the only symbols with a '$' in their name.
+        if (sym_tab->pool_lookup(sym_tab->get_symbol_id(vars[v]))[0] != '$') {
+            named.set(v);
+        }
+        if (sym_tab->get_symbol_level(vars[v]) < local_level) {
+            nonlocal.set(v);
+        }
+    }
+
+    link_blocks();
+}
+
+
+control_flow_graph::~control_flow_graph()
+{
+    for (int b = 0; b < nr_blocks; b++) {
+        delete blocks[b];
+    }
+    delete[] blocks;
+    delete[] order;
+    delete[] rpo_nr;
+    delete[] idom;
+    for (int l = 0; l < nr_loops; l++) {
+        delete loops[l];
+    }
+    delete[] loops;
+    delete[] vars;
+    delete[] var_table;
+}
+
+
+/* Connect each block to the blocks it may continue with, and order the
+   reachable ones by a depth first search from the entry. */
+void control_flow_graph::link_blocks()
+{
+    // The labels of a quad list are numbered close to each other, so the
+    // blocks starting with them are found through an array.
+    long min_label = 0;
+    long max_label = -1;
+    for (int b = 0; b < nr_blocks; b++) {
+        quadruple *first = blocks[b]->quads[0];
+        if (first->op_code == q_labl) {
+            if (max_label < min_label) {
+                min_label = max_label = first->int1;
+            } else if (first->int1 < min_label) {
+                min_label = first->int1;
+            } else if (first->int1 > max_label) {
+                max_label = first->int1;
+            }
+        }
+    }
+    int nr_labels = max_label - min_label + 1;
+    int *label_block = new int[nr_labels > 0 ? nr_labels : 1];
+    for (int l = 0; l < nr_labels; l++) {
+        label_block[l] = -1;
+    }
+    for (int b = 0; b < nr_blocks; b++) {
+        quadruple *first = blocks[b]->quads[0];
+        if (first->op_code == q_labl) {
+            label_block[first->int1 - min_label] = b;
+        }
+    }
+
+    for (int b = 0; b < nr_blocks; b++) {
+        basic_block *block = blocks[b];
+        quadruple *last = block->quads[block->nr_quads - 1];
+        long target;
+        bool falls_through;
+
+        switch (last->op_code) {
+        case q_jmp:
+            target = last->int1;
+            falls_through = false;
+            break;
+        case q_jmpf:
+            target = last->int1;
+            falls_through = true;
+            break;
+        case q_rreturn:
+        case q_ireturn:
+            target = last_label;
+            falls_through = false;
+            break;
+        default:
+            target = -1;
+            falls_through = true;
+            break;
+        }
+
+        block->nr_succ = 0;
+        if (falls_through && b + 1 < nr_blocks) {
+            block->succ[block->nr_succ++] = b + 1;
+        }
+        if (target >= 0) {
+            if (target < min_label || target > max_label ||
+                label_block[target - min_label] < 0) {
+                fatal("control_flow_graph: jump to a missing label");
+            }
+            int t = label_block[target - min_label];
+            if (block->nr_succ == 0 || block->succ[0] != t) {
+                block->succ[block->nr_succ++] = t;
+            }
+        }
+        for (int s = 0; s < block->nr_succ; s++) {
+            blocks[block->succ[s]]->add_pred(b);
+        }
+    }
+    delete[] label_block;
+
+    // Iterative depth first search, giving the blocks in postorder. Each
+    // stack entry is a block and the nr of successors visited so far.
+    int *postorder = new int[nr_blocks];
+    int *stack = new int[nr_blocks * 2];
+    bool *visited = new bool[nr_blocks];
+    int sp = 0;
+    for (int b = 0; b < nr_blocks; b++) {
+        visited[b] = false;
+    }
+    nr_reachable = 0;
+    stack[sp++] = 0;
+    stack[sp++] = 0;
+    visited[0] = true;
+    while (sp > 0) {
+        basic_block *block = blocks[stack[sp - 2]];
+        if (stack[sp - 1] < block->nr_succ) {
+            int s = block->succ[stack[sp - 1]++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack[sp++] = s;
+                stack[sp++] = 0;
+            }
+        } else {
+            postorder[nr_reachable++] = block->nr;
+            sp -= 2;
+        }
+    }
+
+    delete[] order;
+    order = new int[nr_reachable > 0 ? nr_reachable : 1];
+    rpo_nr = new int[nr_blocks];
+    for (int b = 0; b < nr_blocks; b++) {
+        rpo_nr[b] = -1;
+    }
+    for (int i = 0; i < nr_reachable; i++) {
+        order[i] = postorder[nr_reachable - 1 - i];
+        rpo_nr[order[i]] = i;
+    }
+    delete[] postorder;
+    delete[] stack;
+    delete[] visited;
+}
+
+
+/*** Dominators and loops. ***/
+
+/* Find the immediate dominators with the algorithm by Cooper, Harvey and
+   Kennedy: the dominator of a block is the nearest common dominator of its
+   predecessors, which is found by walking up the dominator tree by reverse
+   postorder numbers. */
+void control_flow_graph::find_dominators()
+{
+    delete[] idom;
+    idom = new int[nr_blocks];
+    for (int b = 0; b < nr_blocks; b++) {
+        idom[b] = -1;
+    }
+    idom[0] = 0;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < nr_reachable; i++) {
+            basic_block *block = blocks[order[i]];
+            int new_idom = -1;
+            for (int p = 0; p < block->nr_preds; p++) {
+                int pred = block->preds[p];
+                if (idom[pred] < 0) {
+                    continue;
+                }
+                if (new_idom < 0) {
+                    new_idom = pred;
+                    continue;
+                }
+                int a = pred;
+                int b = new_idom;
+                while (a != b) {
+                    while (rpo_nr[a] > rpo_nr[b]) {
+                        a = idom[a];
+                    }
+                    while (rpo_nr[b] > rpo_nr[a]) {
+                        b = idom[b];
+                    }
+                }
+                new_idom = a;
+            }
+            if (idom[block->nr] != new_idom) {
+                idom[block->nr] = new_idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+
+bool control_flow_graph::dominates(int a, int b)
+{
+    while (rpo_nr[b] > rpo_nr[a]) {
+        b = idom[b];
+    }
+    return a == b;
+}
+
+
+natural_loop::natural_loop(int h, int nr_graph_blocks) :
+    header(h),
+    blocks(NULL),
+    nr_blocks(0)
+{
+    body.resize(nr_graph_blocks);
+    body.set(h);
+}
+
+natural_loop::~natural_loop()
+{
+    delete[] blocks;
+}
+
+
+/* Find the loops from the back edges, ie, the edges to a block dominating
+   the block they leave. The body of a loop is found by searching backwards
+   from the back edges, stopping at the header. */
+void control_flow_graph::find_loops()
+{
+    find_dominators();
+
+    for (int l = 0; l < nr_loops; l++) {
+        delete loops[l];
+    }
+    delete[] loops;
+    loops = new natural_loop*[nr_blocks];
+    nr_loops = 0;
+
+    natural_loop **loop_of = new natural_loop*[nr_blocks];
+    int *stack = new int[nr_blocks];
+    for (int b = 0; b < nr_blocks; b++) {
+        loop_of[b] = NULL;
+    }
+
+    for (int i = 0; i < nr_reachable; i++) {
+        basic_block *block = blocks[order[i]];
+        for (int s = 0; s < block->nr_succ; s++) {
+            int h = block->succ[s];
+            if (!dominates(h, block->nr)) {
+                continue;
+            }
+            if (loop_of[h] == NULL) {
+                loop_of[h] = new natural_loop(h, nr_blocks);
+                loops[nr_loops++] = loop_of[h];
+            }
+            natural_loop *loop = loop_of[h];
+            int sp = 0;
+            if (!loop->body.test(block->nr)) {
+                loop->body.set(block->nr);
+                stack[sp++] = block->nr;
+            }
+            while (sp > 0) {
+                basic_block *member = blocks[stack[--sp]];
+                for (int p = 0; p < member->nr_preds; p++) {
+                    int pred = member->preds[p];
+                    if (rpo_nr[pred] >= 0 && !loop->body.test(pred)) {
+                        loop->body.set(pred);
+                        stack[sp++] = pred;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int l = 0; l < nr_loops; l++) {
+        natural_loop *loop = loops[l];
+        for (int i = 0; i < nr_reachable; i++) {
+            if (loop->body.test(order[i])) {
+                loop->nr_blocks++;
+            }
+        }
+        loop->blocks = new int[loop->nr_blocks];
+        loop->nr_blocks = 0;
+        for (int i = 0; i < nr_reachable; i++) {
+            if (loop->body.test(order[i])) {
+                loop->blocks[loop->nr_blocks++] = order[i];
+            }
+        }
+    }
+
+    // An inner loop has fewer blocks than the loops around it.
+    for (int i = 1; i < nr_loops; i++) {
+        natural_loop *loop = loops[i];
+        int j = i;
+        while (j > 0 && loops[j - 1]->nr_blocks > loop->nr_blocks) {
+            loops[j] = loops[j - 1];
+            j--;
+        }
+        loops[j] = loop;
+    }
+
+    delete[] loop_of;
+    delete[] stack;
+}
+
+
+/* Build a quad list of the blocks in their original order. */
+quad_list *control_flow_graph::to_quad_list()
+{
+    quad_list *q = new quad_list(last_label);
+    for (int b = 0; b < nr_blocks; b++) {
+        for (int i = 0; i < blocks[b]->nr_quads; i++) {
+            (*q) += blocks[b]->quads[i];
+        }
+    }
+    return q;
+}
+
+
+/*** The dataflow solver. ***/
+
+dataflow_problem::dataflow_problem(control_flow_graph *g, bool fw,
+                                   bool meet_intersect) :
+    cfg(g),
+    forward(fw),
+    intersect(meet_intersect),
+    nr_bits(0),
+    gen(NULL),
+    kill(NULL),
+    in(NULL),
+    out(NULL),
+    nr_passes(0)
+{
+}
+
+dataflow_problem::~dataflow_problem()
+{
+    delete[] gen;
+    delete[] kill;
+    delete[] in;
+    delete[] out;
+}
+
+
+void dataflow_problem::allocate(int bits)
+{
+    int n = cfg->nr_blocks;
+
+    nr_bits = bits;
+    gen = new bit_vector[n];
+    kill = new bit_vector[n];
+    in = new bit_vector[n];
+    out = new bit_vector[n];
+    for (int b = 0; b < n; b++) {
+        gen[b].resize(bits);
+        kill[b].resize(bits);
+        in[b].resize(bits);
+        out[b].resize(bits);
+        if (intersect) {
+            in[b].fill();
+            out[b].fill();
+        }
+    }
+    boundary.resize(bits);
+}
+
+
+/* Iterate over the reachable blocks until no set changes. Visiting them in
+   reverse postorder (forward) or postorder (backward) means a pass over a
+   loop free graph is enough, and each nesting level of loops costs about
+   one more pass. */
+void dataflow_problem::solve()
+{
+    bit_vector meet;
+    bit_vector result;
+    bool changed = true;
+
+    meet.resize(nr_bits);
+    result.resize(nr_bits);
+    nr_passes = 0;
+    while (changed) {
+        changed = false;
+        nr_passes++;
+        for (int i = 0; i < cfg->nr_reachable; i++) {
+            int b = cfg->order[forward ? i : cfg->nr_reachable - 1 - i];
+            basic_block *block = cfg->blocks[b];
+
+            // Meet the sets flowing into the block.
+            bool first = true;
+            if (forward ? b == 0 : block->nr_succ == 0) {
+                meet.copy(boundary);
+                first = false;
+            }
+            int nr_edges = forward ? block->nr_preds : block->nr_succ;
+            for (int e = 0; e < nr_edges; e++) {
+                int other = forward ? block->preds[e] : block->succ[e];
+                bit_vector &flow = forward ? out[other] : in[other];
+                if (first) {
+                    meet.copy(flow);
+                    first = false;
+                } else if (intersect) {
+                    meet.intersect(flow);
+                } else {
+                    meet.unite(flow);
+                }
+            }
+            if (first) {
+                // A block that can't be left never reaches an exit.
+                meet.clear();
+            }
+
+            // Apply the transfer function.
+            result.copy(meet);
+            result.subtract(kill[b]);
+            result.unite(gen[b]);
+            if (forward) {
+                in[b].copy(meet);
+                if (!result.equals(out[b])) {
+                    out[b].copy(result);
+                    changed = true;
+                }
+            } else {
+                out[b].copy(meet);
+                if (!result.equals(in[b])) {
+                    in[b].copy(result);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+
+/*** Live variables. ***/
+
+/* Walk each block backwards. A write hides the reads below it, and a read
+   makes the variable live above it. */
+liveness::liveness(control_flow_graph *g) :
+    dataflow_problem(g, false, false)
+{
+    allocate(g->nr_vars);
+
+    for (int b = 0; b < g->nr_blocks; b++) {
+        basic_block *block = g->blocks[b];
+        for (int i = block->nr_quads - 1; i >= 0; i--) {
+            quadruple *q = block->quads[i];
+            int v = g->var_nr(quad_result(q));
+            if (v >= 0) {
+                gen[b].reset(v);
+                kill[b].set(v);
+            }
+            if (q->op_code == q_call) {
+                gen[b].unite(g->named);
+            }
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            for (int o = 0; o < nr_ops; o++) {
+                v = g->var_nr(ops[o]);
+                if (v >= 0) {
+                    gen[b].set(v);
+                }
+            }
+        }
+    }
+
+    // The caller may read its own variables after we return.
+    boundary.copy(g->named);
+    boundary.intersect(g->nonlocal);
+
+    solve();
+}
+
+
+/*** Reaching definitions. ***/
+
+reaching_definitions::reaching_definitions(control_flow_graph *g) :
+    dataflow_problem(g, true, false)
+{
+    // Number the definitions, the unknown ones first.
+    int nr_defs = g->nr_vars;
+    for (int b = 0; b < g->nr_blocks; b++) {
+        for (int i = 0; i < g->blocks[b]->nr_quads; i++) {
+            if (g->var_nr(quad_result(g->blocks[b]->quads[i])) >= 0) {
+                nr_defs++;
+            }
+        }
+    }
+    def_quads = new quadruple*[nr_defs > 0 ? nr_defs : 1];
+    def_vars = new int[nr_defs > 0 ? nr_defs : 1];
+    for (int v = 0; v < g->nr_vars; v++) {
+        def_quads[v] = NULL;
+        def_vars[v] = v;
+    }
+    nr_defs = g->nr_vars;
+    for (int b = 0; b < g->nr_blocks; b++) {
+        for (int i = 0; i < g->blocks[b]->nr_quads; i++) {
+            quadruple *q = g->blocks[b]->quads[i];
+            int v = g->var_nr(quad_result(q));
+            if (v >= 0) {
+                def_quads[nr_defs] = q;
+                def_vars[nr_defs] = v;
+                nr_defs++;
+            }
+        }
+    }
+
+    allocate(nr_defs);
+
+    // The definitions of each variable, which a write kills, as lists
+    // packed into one array like the uses in available_expressions.
+    int *first = new int[g->nr_vars + 1];
+    int *var_defs = new int[nr_defs > 0 ? nr_defs : 1];
+    for (int v = 0; v <= g->nr_vars; v++) {
+        first[v] = 0;
+    }
+    for (int d = 0; d < nr_defs; d++) {
+        first[def_vars[d] + 1]++;
+    }
+    for (int v = 0; v < g->nr_vars; v++) {
+        first[v + 1] += first[v];
+    }
+    int *fill = new int[g->nr_vars > 0 ? g->nr_vars : 1];
+    for (int v = 0; v < g->nr_vars; v++) {
+        fill[v] = first[v];
+    }
+    for (int d = 0; d < nr_defs; d++) {
+        var_defs[fill[def_vars[d]]++] = d;
+    }
+    delete[] fill;
+
+    int d = g->nr_vars;
+    for (int b = 0; b < g->nr_blocks; b++) {
+        basic_block *block = g->blocks[b];
+        for (int i = 0; i < block->nr_quads; i++) {
+            quadruple *q = block->quads[i];
+            if (q->op_code == q_call) {
+                // A call may or may not write the named variables.
+                for (int v = 0; v < g->nr_vars; v++) {
+                    if (g->named.test(v)) {
+                        gen[b].set(v);
+                    }
+                }
+            }
+            int v = g->var_nr(quad_result(q));
+            if (v >= 0) {
+                for (int k = first[v]; k < first[v + 1]; k++) {
+                    gen[b].reset(var_defs[k]);
+                    kill[b].set(var_defs[k]);
+                }
+                gen[b].set(d);
+                d++;
+            }
+        }
+    }
+    delete[] first;
+    delete[] var_defs;
+
+    for (int v = 0; v < g->nr_vars; v++) {
+        boundary.set(v);
+    }
+
+    solve();
+}
+
+reaching_definitions::~reaching_definitions()
+{
+    delete[] def_quads;
+    delete[] def_vars;
+}
+
+
+/*** Available expressions. ***/
+
+/* The operands identifying the expression of a pure quad. The literal
+   argument counts as an operand for the loads and the shifts, and the
+   array for the index quads. */
+static void expr_key(quadruple *q, long *a, long *b)
+{
+    switch (q->op_code) {
+    case q_rload:
+    case q_iload:
+        *a = q->int1;
+        *b = 0;
+        break;
+    case q_ishl:
+    case q_isar:
+    case q_iand_mask:
+        *a = q->sym1;
+        *b = q->int2;
+        break;
+    case q_inot:
+    case q_ruminus:
+    case q_iuminus:
+    case q_itor:
+        *a = q->sym1;
+        *b = 0;
+        break;
+    default:
+        *a = q->sym1;
+        *b = q->sym2;
+        break;
+    }
+    if (is_commutative(q->op_code) && *a > *b) {
+        long t = *a;
+        *a = *b;
+        *b = t;
+    }
+}
+
+static unsigned long expr_hash(quad_op_type op, long a, long b)
+{
+    return ((unsigned long) op * 31 + a) * 2654435761UL + b * 40503UL;
+}
+
+
+/* Return the nr of the expression computed by a quad, or -1. */
+int available_expressions::expr_nr(quadruple *q)
+{
+    if (!is_pure_quad(q)) {
+        return -1;
+    }
+    long a, b;
+    expr_key(q, &a, &b);
+    int i = expr_hash(q->op_code, a, b) & (table_size - 1);
+    while (table[i] >= 0) {
+        quadruple *e = exprs[table[i]];
+        long ea, eb;
+        expr_key(e, &ea, &eb);
+        if (e->op_code == q->op_code && ea == a && eb == b) {
+            return table[i];
+        }
+        i = (i + 1) & (table_size - 1);
+    }
+    return -1;
+}
+
+
+available_expressions::available_expressions(control_flow_graph *g) :
+    dataflow_problem(g, true, true),
+    nr_exprs(0),
+    exprs_size(0)
+{
+    int nr_pure = 0;
+    for (int b = 0; b < g->nr_blocks; b++) {
+        for (int i = 0; i < g->blocks[b]->nr_quads; i++) {
+            if (is_pure_quad(g->blocks[b]->quads[i])) {
+                nr_pure++;
+            }
+        }
+    }
+
+    // Enter the distinct expressions in a hash table at most half full.
+    exprs_size = nr_pure > 0 ? nr_pure : 1;
+    exprs = new quadruple*[exprs_size];
+    table_size = 16;
+    while (table_size < nr_pure * 2) {
+        table_size *= 2;
+    }
+    table = new int[table_size];
+    memset(table, 0xff, table_size * sizeof(int));
+    for (int b = 0; b < g->nr_blocks; b++) {
+        for (int i = 0; i < g->blocks[b]->nr_quads; i++) {
+            quadruple *q = g->blocks[b]->quads[i];
+            if (is_pure_quad(q) && expr_nr(q) < 0) {
+                long a, b;
+                expr_key(q, &a, &b);
+                int s = expr_hash(q->op_code, a, b) & (table_size - 1);
+                while (table[s] >= 0) {
+                    s = (s + 1) & (table_size - 1);
+                }
+                table[s] = nr_exprs;
+                exprs[nr_exprs++] = q;
+            }
+        }
+    }
+
+    allocate(nr_exprs);
+
+    // The expressions reading each variable, as lists packed into one
+    // array: those of variable v are uses[first[v]] to uses[first[v+1]-1].
+    int *first = new int[g->nr_vars + 1];
+    int *uses = new int[nr_exprs * 2 + 1];
+    bit_vector memory;
+    bit_vector named_uses;
+    memory.resize(nr_exprs);
+    named_uses.resize(nr_exprs);
+    for (int v = 0; v <= g->nr_vars; v++) {
+        first[v] = 0;
+    }
+    for (int e = 0; e < nr_exprs; e++) {
+        sym_index ops[2];
+        int nr_ops = quad_operands(exprs[e], ops);
+        for (int o = 0; o < nr_ops; o++) {
+            int v = g->var_nr(ops[o]);
+            if (v >= 0) {
+                first[v + 1]++;
+                if (g->named.test(v)) {
+                    named_uses.set(e);
+                }
+            }
+        }
+        if (exprs[e]->op_code == q_rrindex ||
+            exprs[e]->op_code == q_irindex) {
+            memory.set(e);
+        }
+    }
+    for (int v = 0; v < g->nr_vars; v++) {
+        first[v + 1] += first[v];
+    }
+    int *fill = new int[g->nr_vars > 0 ? g->nr_vars : 1];
+    for (int v = 0; v < g->nr_vars; v++) {
+        fill[v] = first[v];
+    }
+    for (int e = 0; e < nr_exprs; e++) {
+        sym_index ops[2];
+        int nr_ops = quad_operands(exprs[e], ops);
+        for (int o = 0; o < nr_ops; o++) {
+            int v = g->var_nr(ops[o]);
+            if (v >= 0) {
+                uses[fill[v]++] = e;
+            }
+        }
+    }
+    delete[] fill;
+
+    for (int b = 0; b < g->nr_blocks; b++) {
+        basic_block *block = g->blocks[b];
+        for (int i = 0; i < block->nr_quads; i++) {
+            quadruple *q = block->quads[i];
+            int e = expr_nr(q);
+            if (e >= 0) {
+                gen[b].set(e);
+            }
+            if (q->op_code == q_rstore || q->op_code == q_istore) {
+                gen[b].subtract(memory);
+                kill[b].unite(memory);
+            } else if (q->op_code == q_call) {
+                gen[b].subtract(memory);
+                kill[b].unite(memory);
+                gen[b].subtract(named_uses);
+                kill[b].unite(named_uses);
+            }
+            // Writing an operand kills the expression, even the one just
+            // computed if it wrote one of its own operands.
+            int v = g->var_nr(quad_result(q));
+            if (v >= 0) {
+                for (int u = first[v]; u < first[v + 1]; u++) {
+                    gen[b].reset(uses[u]);
+                    kill[b].set(uses[u]);
+                }
+            }
+        }
+    }
+    delete[] first;
+    delete[] uses;
+
+    // Nothing is available at the entry.
+    solve();
+}
+
+available_expressions::~available_expressions()
+{
+    delete[] exprs;
+    delete[] table;
+}
+
+
+/*** Printing. ***/
+
+static double now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+/* Run each analysis once and print its size, nr of passes and time. The
+   time includes computing the gen and kill sets. */
+void control_flow_graph::print_statistics(ostream &o)
+{
+    double start;
+
+    o << nr_blocks << " blocks, " << nr_reachable << " reachable, "
+      << nr_vars << " variables" << endl;
+
+    start = now_us();
+    liveness *live = new liveness(this);
+    o << "  liveness:             " << setw(7) << live->nr_bits << " bits"
+      << setw(5) << live->nr_passes << " passes"
+      << setw(10) << fixed << setprecision(0) << now_us() - start << " us"
+      << endl;
+    delete live;
+
+    start = now_us();
+    reaching_definitions *reach = new reaching_definitions(this);
+    o << "  reaching definitions: " << setw(7) << reach->nr_bits << " bits"
+      << setw(5) << reach->nr_passes << " passes"
+      << setw(10) << fixed << setprecision(0) << now_us() - start << " us"
+      << endl;
+    delete reach;
+
+    start = now_us();
+    available_expressions *avail = new available_expressions(this);
+    o << "  available expressions:" << setw(7) << avail->nr_bits << " bits"
+      << setw(5) << avail->nr_passes << " passes"
+      << setw(10) << fixed << setprecision(0) << now_us() - start << " us"
+      << endl;
+    delete avail;
+
+    o.unsetf(ios::floatfield);
+}
+
+
+/* Print the blocks with their quads numbered like in a quad list. */
+ostream &operator<<(ostream &o, control_flow_graph *g)
+{
+    int quad_nr = 1;
+
+    o << short_symbols;
+    for (int b = 0; b < g->nr_blocks; b++) {
+        basic_block *block = g->blocks[b];
+        o << "Block " << b << "  preds:";
+        for (int p = 0; p < block->nr_preds; p++) {
+            o << " " << block->preds[p];
+        }
+        o << "  succs:";
+        for (int s = 0; s < block->nr_succ; s++) {
+            o << " " << block->succ[s];
+        }
+        o << endl;
+        for (int i = 0; i < block->nr_quads; i++) {
+            o << setw(5) << quad_nr++ << block->quads[i] << endl;
+        }
+    }
+    o << long_symbols;
+    return o;
+}
@@ -0,0 +1,304 @@
+#ifndef __CFG_HH__
+#define __CFG_HH__
+
+#include "quads.hh"
+
+
+/*** Control flow graphs and dataflow analysis over quads. A quad list is
+     split into basic blocks at labels, jumps and returns. The solver in
+     class dataflow_problem is shared by the analyses below it, which only
+     have to fill in the gen and kill sets of each block. ***/
+
+
+// --- Quad operands. ---
+
+// Return the variable a quad writes, or NULL_SYM.
+sym_index quad_result(quadruple *);
+
+// Store the symbols a quad reads in the array, and return how many there
+// are (at most 2). Literal arguments, labels and array symbols are left out.
+int quad_operands(quadruple *, sym_index *);
+
+// The same, but stores pointers to the quad's fields so they can be
+// rewritten.
+int quad_operand_refs(quadruple *, sym_index **);
+
+// Returns true for quads that compute a value from their operands alone,
+// ie, the ones available expressions and value numbering deal with.
+bool is_pure_quad(quadruple *);
+
+// Returns true for the op codes whose two operands can be swapped.
+bool is_commutative(quad_op_type);
+
+
+// --- Bit vectors. ---
+
+class bit_vector
+{
+private:
+    unsigned long *words;
+    int nr_words;
+    int nr_bits;
+
+    // Not copyable, use copy().
+    bit_vector(const bit_vector &);
+    bit_vector &operator=(const bit_vector &);
+
+public:
+    bit_vector();
+    ~bit_vector();
+
+    // Reallocate for the given nr of bits, all of them cleared.
+    void resize(int);
+
+    int size() const { return nr_bits; }
+
+    bool test(int i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(int i) { words[i / 64] |= 1UL << (i % 64); }
+
+    void reset(int i) { words[i / 64] &= ~(1UL << (i % 64)); }
+
+    void clear();
+    void fill();
+    void copy(const bit_vector &);
+    bool equals(const bit_vector &) const;
+
+    // this = this | other, this & other and this & ~other.
+    void unite(const bit_vector &);
+    void intersect(const bit_vector &);
+    void subtract(const bit_vector &);
+};
+
+
+// --- The control flow graph. ---
+
+/* A basic block, ie, quads that are always executed from the first one to
+   the last one. Only the first quad can be a label, and only the last one a
+   jump or a return. */
+class basic_block
+{
+public:
+    // Index in control_flow_graph::blocks.
+    int nr;
+
+    quadruple **quads;
+    int nr_quads;
+    int quads_size;
+
+    // Successors, the fall-through block first. A block ending with a
+    // conditional jump to the next block has only one successor.
+    int succ[2];
+    int nr_succ;
+
+    int *preds;
+    int nr_preds;
+    int preds_size;
+
+    basic_block(int);
+    ~basic_block();
+
+    void append_quad(quadruple *);
+    void add_pred(int);
+};
+
+
+/* A natural loop, ie, a header block and the blocks that can reach a back
+   edge to it without passing through it. Back edges to the same header give
+   one loop. */
+class natural_loop
+{
+public:
+    int header;
+
+    // The blocks of the loop as a set of block nrs, and as a list in
+    // reverse postorder, starting with the header.
+    bit_vector body;
+    int *blocks;
+    int nr_blocks;
+
+    natural_loop(int, int);
+    ~natural_loop();
+};
+
+
+class control_flow_graph
+{
+private:
+    // Open hash table from sym_index to variable nr, -1 for empty slots.
+    int *var_table;
+    int var_table_size;
+
+    int var_slot(sym_index);
+
+    // Number the variables used in the quads.
+    void number_variable(sym_index);
+
+    // Find the edges between the blocks and the block order.
+    void link_blocks();
+
+    // Find the immediate dominators, see find_loops().
+    void find_dominators();
+
+public:
+    // Block 0 is the entry. Blocks without successors are exits.
+    basic_block **blocks;
+    int nr_blocks;
+    int blocks_size;
+
+    // The label of the quad list, which returns jump to.
+    int last_label;
+
+    // The blocks reachable from the entry, in reverse postorder. Forward
+    // problems are solved in this order, backward ones in the opposite.
+    int *order;
+    int nr_reachable;
+
+    // Position of each block in order, -1 for unreachable blocks.
+    int *rpo_nr;
+
+    // The immediate dominator of each reachable block. The entry is its
+    // own. Only valid after find_loops().
+    int *idom;
+
+    // The loops, inner loops before the loops containing them. Only valid
+    // after find_loops().
+    natural_loop **loops;
+    int nr_loops;
+
+    // The variables and parameters used in the quads, numbered from 0.
+    // Constants and arrays aren't numbered.
+    sym_index *vars;
+    int nr_vars;
+    int vars_size;
+
+    // Set for the variables that are not temporaries, ie, the ones that
+    // can be read or written by a call. See also nonlocal.
+    bit_vector named;
+
+    // Set for the variables declared outside the block being compiled.
+    bit_vector nonlocal;
+
+    control_flow_graph(quad_list *);
+    ~control_flow_graph();
+
+    // The nr given to a variable, or -1 if it isn't one.
+    int var_nr(sym_index);
+
+    // Find the dominators and the loops of the graph.
+    void find_loops();
+
+    // Returns true if every path from the entry to the second block passes
+    // through the first one. Both must be reachable.
+    bool dominates(int, int);
+
+    // Build a new quad list from the blocks. The quads are shared.
+    quad_list *to_quad_list();
+
+    // Solve the dataflow problems below and print how costly it was.
+    void print_statistics(ostream &);
+
+    friend ostream &operator<<(ostream &, control_flow_graph *);
+};
+
+
+// --- Dataflow analysis. ---
+
+/* The generic iterative solver. A subclass fills in gen, kill and boundary
+   for its problem and calls solve(). The transfer function of a block is
+   out = gen | (in & ~kill) for forward problems, and the same from out to
+   in for backward ones. The boundary set is met with the sets flowing into
+   the entry block (forward) or the exit blocks (backward). */
+class dataflow_problem
+{
+protected:
+    control_flow_graph *cfg;
+
+    bool forward;
+
+    // Meet with intersection (all paths) rather than union (some path).
+    bool intersect;
+
+    bit_vector boundary;
+
+    // Allocate the sets, all of them to nr_bits bits. in and out start out
+    // as the identity of the meet.
+    void allocate(int);
+
+    void solve();
+
+public:
+    int nr_bits;
+
+    // Indexed by block nr.
+    bit_vector *gen;
+    bit_vector *kill;
+    bit_vector *in;
+    bit_vector *out;
+
+    // Nr of passes over the blocks before nothing changed.
+    int nr_passes;
+
+    dataflow_problem(control_flow_graph *, bool, bool);
+    virtual ~dataflow_problem();
+};
+
+
+/* Live variables. A bit per variable number. A variable is live if it may
+   be read before it is written. Calls read all named variables, and the
+   nonlocal ones are live at the exits. */
+class liveness : public dataflow_problem
+{
+public:
+    liveness(control_flow_graph *);
+};
+
+
+/* Reaching definitions. The first nr_vars bits stand for an unknown value
+   of each variable, which is what it has at the entry and after a call may
+   have written it. The rest are the quads that write a variable. */
+class reaching_definitions : public dataflow_problem
+{
+public:
+    // Defining quad of each bit, NULL for the unknown ones.
+    quadruple **def_quads;
+
+    // Variable nr written by each bit.
+    int *def_vars;
+
+    reaching_definitions(control_flow_graph *);
+    ~reaching_definitions();
+};
+
+
+/* Available expressions. A bit per distinct pure quad, that is, op code
+   and operands. An expression is available if it has been computed on every
+   path and none of its operands has been written since. Stores and calls
+   kill the array reads, and calls also kill the expressions with named
+   operands. */
+class available_expressions : public dataflow_problem
+{
+public:
+    // A quad computing each expression.
+    quadruple **exprs;
+    int nr_exprs;
+
+    // The expression computed by a quad, or -1.
+    int expr_nr(quadruple *);
+
+    available_expressions(control_flow_graph *);
+    ~available_expressions();
+
+private:
+    int exprs_size;
+
+    // Open hash table of expression nrs, -1 for empty slots.
+    int *table;
+    int table_size;
+};
+
+
+#endif
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "symtab.hh"
 #include "quads.hh"
@@ -150,23 +151,20 @@ void code_generator::epilogue(symbol *old_env)
 void code_generator::find(sym_index sym_p, int *level, int *offset)
 {
     /* Your code here */
-    symbol *sym = sym_tab->get_symbol(sym_p);
-    *level = sym->level;
-    sym_type tag = sym->tag;
+    // Only the hot fields are needed, so we never touch the symbol itself.
+    *level = sym_tab->get_symbol_level(sym_p);
+    sym_type tag = sym_tab->get_symbol_tag(sym_p);
     if (tag == SYM_VAR || tag == SYM_ARRAY)
     {
-        //printf("Variable: \"%s\". Symbol offset: %d\n", sym_tab->pool_lookup(sym->id), sym->offset);
-    
         //Offset for local variable's are the display area plus it's internal offset
-        *offset = -((*level+1)*STACK_WIDTH + sym->offset);
+        *offset = -((*level+1)*STACK_WIDTH + sym_tab->get_symbol_offset(sym_p));
 
     }
     else if (tag == SYM_PARAM)
     {   
         // Jump over previous return address + the offset of the param
         // in the param list. Then get to the start of the param b its size
-        //printf("Parameter: \"%s\". Symbol offset: %d\n", sym_tab->pool_lookup(sym->id), sym->offset);
-        *offset = STACK_WIDTH*2 + sym->offset;
+        *offset = STACK_WIDTH*2 + sym_tab->get_symbol_offset(sym_p);
     }
 }
 
@@ -184,11 +182,10 @@ void code_generator::frame_address(int level, const register_type dest)
 void code_generator::fetch(sym_index sym_p, register_type dest)
 {
     /* Your code here */
-    symbol *sym = sym_tab->get_symbol(sym_p);
-    sym_type tag = sym->tag;
+    sym_type tag = sym_tab->get_symbol_tag(sym_p);
     if (tag == SYM_CONST) 
     {
-        constant_symbol *cs = sym->get_constant_symbol();
+        constant_symbol *cs = sym_tab->get_symbol(sym_p)->get_constant_symbol();
         long value;
         if (cs->type == real_type)
         {
@@ -238,11 +235,10 @@ void code_generator::fetch(sym_index sym_p, register_type dest)
 void code_generator::fetch_float(sym_index sym_p)
 {
     /* Your code here */
-    symbol *sym = sym_tab->get_symbol(sym_p);
-    sym_type tag = sym->tag;
+    sym_type tag = sym_tab->get_symbol_tag(sym_p);
     if (tag == SYM_CONST) 
     {
-        constant_symbol *cs = sym->get_constant_symbol();
+        constant_symbol *cs = sym_tab->get_symbol(sym_p)->get_constant_symbol();
         long value = sym_tab->ieee(cs->const_value.rval);
         
         STREAM << "\t\t" << "mov" << "\t" << "rcx, " << value << endl;
@@ -507,6 +503,30 @@ void code_generator::expand(quad_list *q_list)
             store(RDX, q->sym3);
             break;
 
+        case q_ishl:
+            fetch(q->sym1, RAX);
+            STREAM<< "\t\t" << "shl" << "\t" << "rax, " << q->int2 << endl;
+            store(RAX, q->sym3);
+            break;
+
+        case q_isar:
+            fetch(q->sym1, RAX);
+            STREAM<< "\t\t" << "sar" << "\t" << "rax, " << q->int2 << endl;
+            store(RAX, q->sym3);
+            break;
+
+        case q_iand_mask:
+            fetch(q->sym1, RAX);
+            // and only takes a sign extended 32-bit immediate.
+            if (q->int2 >= INT32_MIN && q->int2 <= INT32_MAX) {
+                STREAM<< "\t\t" << "and" << "\t" << "rax, " << q->int2 << endl;
+            } else {
+                STREAM<< "\t\t" << "mov" << "\t" << "rcx, " << q->int2 << endl;
+                STREAM<< "\t\t" << "and" << "\t" << "rax, rcx" << endl;
+            }
+            store(RAX, q->sym3);
+            break;
+
         case q_req: {
             int label = sym_tab->get_next_label();
             int label2 = sym_tab->get_next_label();
@@ -770,6 +790,15 @@ void code_generator::expand(quad_list *q_list)
             store(RAX, q->sym3);
             break;
 
+        case q_bounds:
+            // The unsigned compare catches negative indices too. The
+            // handler in diesel_glue.s reads RAX and RCX.
+            fetch(q->sym1, RAX);
+            STREAM << "\t\t" << "mov" << "\t" << "rcx, " << q->int2 << endl;
+            STREAM << "\t\t" << "cmp" << "\t" << "rax, rcx" << endl;
+            STREAM << "\t\t" << "jae" << "\t" << "bounds_error" << endl;
+            break;
+
         case q_itor: {
             block_level level;      // Current scope level.
             int offset;             // Offset within current activation record.
@@ -41,6 +41,14 @@ L1: # write procedure
     call    myputchar    # in diesel_rts.o
     ret
 
+bounds_error: # array index out of bounds
+    # Jumped to by a failed bounds check, with the index in RAX and the
+    # size of the array in RCX. Never returns.
+    mov rdi, rax
+    mov rsi, rcx
+    and rsp, -16
+    call    diesel_bounds_error    # in diesel_rts.o
+
 L2: # trunc function
     # This very cryptic instruction
     # ConVerTs with Truncation a Signed Double TO a Signed Integer
@@ -1,8 +1,16 @@
 /* diesel_rts.c */
 #include <stdio.h>
+#include <stdlib.h>
 // Compile with gcc -c diesel_rts.c -o diesel_rts.o -Wall -m64
 
 void myputchar(int ch) {
     putc(ch, stdout);
     fflush(stdout);
 }
+
+void diesel_bounds_error(long index, long size) {
+    fflush(stdout);
+    fprintf(stderr, "Array index %ld out of bounds [0, %ld]\n",
+            index, size - 1);
+    exit(1);
+}
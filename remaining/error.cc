@@ -20,10 +20,10 @@ ostream &error(string header)
 
 
 /* Error outstream with position information given. */
-ostream &error(position_information *pos)
+ostream &error(position_information pos)
 {
-    return error("Error") << " line " << pos->get_line()
-           << ", col " << pos->get_column() << ": ";
+    return error("Error") << " line " << pos.get_line()
+           << ", col " << pos.get_column() << ": ";
 }
 
 
@@ -52,13 +52,13 @@ ostream &type_error()
 
 
 /* Same as above, but with position information given as well. */
-ostream &type_error(position_information *pos)
+ostream &type_error(position_information pos)
 {
-    if (pos == NULL) {
+    if (pos.is_unknown()) {
         return type_error();
     }
-    return error("Type conflict, line ") << pos->get_line()
-           << ", col " << pos->get_column()
+    return error("Type conflict, line ") << pos.get_line()
+           << ", col " << pos.get_column()
            << ": ";
 }
 
@@ -71,44 +71,105 @@ ostream &debug(string header)
 
 
 /* General trace print function, used for debugging. */
-ostream &debug(position_information *pos)
+ostream &debug(position_information pos)
 {
-    if (pos == NULL) {
+    if (pos.is_unknown()) {
         return debug();
     }
-    return debug("Debug") << " (line " << pos->get_line()
-           << ", col " << pos->get_column() << "): ";
+    return debug("Debug") << " (line " << pos.get_line()
+           << ", col " << pos.get_column() << "): ";
 }
 
 
 
 /*** Function bodies for the position_information class. ***/
 
+// Nr of bits used for the column in a packed position. The line gets the
+// remaining bits except the top one.
+static const int COLUMN_BITS = 12;
+static const unsigned int MAX_COLUMN = (1u << COLUMN_BITS) - 1;
+static const unsigned int MAX_LINE = (1u << (31 - COLUMN_BITS)) - 1;
+
+// Set in positions that are kept in the side table below.
+static const unsigned int BIG_POSITION = 1u << 31;
+
+// The position returned by position_information::unknown().
+static const unsigned int UNKNOWN_POSITION = 0xffffffff;
+
+// Positions with a line or column too large to be packed. This only happens
+// for huge files or very long lines, so the table is normally empty.
+struct big_position {
+    int line;
+    int column;
+};
+
+static big_position *big_positions = NULL;
+static int big_positions_size = 0;
+static int nr_big_positions = 0;
+
+
 /* Default constructor for position information. */
 position_information::position_information()
 {
-    line = 0;
-    column = 0;
+    loc = 0;
 }
 
 
 /* Constructor for position information with positions given. */
 position_information::position_information(int l, int c)
 {
-    line = l;
-    column = c;
+    if (l >= 0 && c >= 0 &&
+        (unsigned int) l <= MAX_LINE && (unsigned int) c <= MAX_COLUMN) {
+        loc = ((unsigned int) l << COLUMN_BITS) | (unsigned int) c;
+        return;
+    }
+    if (nr_big_positions == big_positions_size) {
+        int new_size = big_positions_size == 0 ? 64 : big_positions_size * 2;
+        big_position *tmp = new big_position[new_size];
+        for (int i = 0; i < nr_big_positions; i++) {
+            tmp[i] = big_positions[i];
+        }
+        delete[] big_positions;
+        big_positions = tmp;
+        big_positions_size = new_size;
+    }
+    big_positions[nr_big_positions].line = l;
+    big_positions[nr_big_positions].column = c;
+    loc = BIG_POSITION | nr_big_positions++;
+}
+
+
+/* Return the position used when there is none to give. */
+position_information position_information::unknown()
+{
+    position_information pos;
+    pos.loc = UNKNOWN_POSITION;
+    return pos;
+}
+
+
+/* Returns true for the position made by unknown(). */
+bool position_information::is_unknown() const
+{
+    return loc == UNKNOWN_POSITION;
 }
 
 
 /* Get the line number. */
-int position_information::get_line()
+int position_information::get_line() const
 {
-    return line;
+    if (loc & BIG_POSITION) {
+        return big_positions[loc & ~BIG_POSITION].line;
+    }
+    return loc >> COLUMN_BITS;
 }
 
 
 /* Get the column number. */
-int position_information::get_column()
+int position_information::get_column() const
 {
-    return column;
+    if (loc & BIG_POSITION) {
+        return big_positions[loc & ~BIG_POSITION].column;
+    }
+    return loc & MAX_COLUMN;
 }
@@ -19,22 +19,33 @@ extern int error_count;
 extern int yylineno;
 
 /* This class contains (starting) line and column of a token, and is used to
-   report the positions of errors in the code. */
+   report the positions of errors in the code. It is packed into 32 bits and
+   passed around and stored by value, so the AST nodes don't need a separate
+   allocation for it. Line and column are only decoded when an error is
+   printed. */
 class position_information
 {
 private:
-    int line;
-
-    int column;
+    // The line in the upper bits and the column in the lower COLUMN_BITS.
+    // Positions that don't fit have the top bit set and the index of the
+    // position in a side table in the rest, see error.cc.
+    unsigned int loc;
 
 public:
+    // Line 0, column 0. Used for the predefined symbols.
     position_information();
 
     position_information(int l, int c);
 
-    int get_line();
+    // No position at all, eg, for temporaries. The error routines leave out
+    // the position when given this.
+    static position_information unknown();
+
+    bool is_unknown() const;
+
+    int get_line() const;
 
-    int get_column();
+    int get_column() const;
 };
 
 
@@ -49,15 +60,15 @@ extern void yyerror(string);
 
 extern ostream  &error(string header = "Error: ");
 
-extern ostream  &error(position_information *);
+extern ostream  &error(position_information);
 
 extern ostream  &type_error();
 
-extern ostream  &type_error(position_information *);
+extern ostream  &type_error(position_information);
 
 extern ostream  &debug(string header = "Debug: ");
 
-extern ostream  &debug(position_information *);
+extern ostream  &debug(position_information);
 
 
 #endif
@@ -6,6 +6,7 @@
 
 #include "ast.hh"
 #include "parser.hh"
+#include "quadopt.hh"
 
 using namespace std;
 
@@ -14,15 +15,18 @@ extern bool yydebug;
 bool assembler_trace = false;
 bool print_ast = false;
 bool print_quads = false;
+bool print_flow = false;
 bool typecheck = true;
 bool optimize = true;
 bool quads = true;
 bool assembler = true;
+int unroll_factor = 1;
+bool bounds_check = false;
 
 void usage(char *program_name)
 {
     cerr << "Usage:\n"
-         << program_name << " [-acdfpqsty] inputfile\n"
+         << program_name << " [-acdfgpqrsty] [-u factor] inputfile\n"
          << program_name << " [-h?]\n"
          << "Options:\n"
          << "  -h, -?            Shows this message.\n"
@@ -30,10 +34,14 @@ void usage(char *program_name)
          << "  -c                Disable type checking.\n"
          << "  -d                Turn on parser debugging.\n"
          << "  -f                Don't optimize.\n"
+         << "  -g                Print control flow graphs and dataflow costs.\n"
          << "  -p                Don't generate quads.\n"
          << "  -q                Print quad lists.\n"
+         << "  -r                Check array indices at run time.\n"
          << "  -s                Don't generate assembler code.\n"
          << "  -t                Include trace printouts in assembler code.\n"
+         << "  -u factor         Unroll counted loops factor times, at most "
+         << MAX_UNROLL_SIZE << ".\n"
          << "  -y                Print symbol table.\n";
     exit(1);
 }
@@ -41,11 +49,12 @@ void usage(char *program_name)
 
 int main(int argc, char **argv)
 {
-    char options[] = "acdfpqstyh?";
+    char options[] = "acdfgpqrstu:yh?";
     int option;
     bool print_symtab = false;
 
     extern  FILE *yyin;
+    extern bool scanner_map_file(const char *);
 
     opterr = 0;
     optopt = '?';
@@ -69,6 +78,11 @@ int main(int argc, char **argv)
             cout << "No optimization will be done.\n" << flush;
             optimize = false;
             break;
+        case 'g':
+            cout << "A control flow graph will be printed for each block.\n"
+                 << flush;
+            print_flow = true;
+            break;
         case 'p':
             cout << "No quads will be generated.\n" << flush;
             quads = false;
@@ -78,6 +92,11 @@ int main(int argc, char **argv)
                  << flush;
             print_quads = true;
             break;
+        case 'r':
+            cout << "Array indices will be checked at run time.\n"
+                 << flush;
+            bounds_check = true;
+            break;
         case 's':
             cout << "No assembler code will be generated.\n" << flush;
             assembler = false;
@@ -86,6 +105,14 @@ int main(int argc, char **argv)
             cout << "Assembler code will contain quad labels.\n" << flush;
             assembler_trace = true;
             break;
+        case 'u':
+            unroll_factor = atoi(optarg);
+            if (unroll_factor < 1 || unroll_factor > MAX_UNROLL_SIZE) {
+                usage(argv[0]);
+            }
+            cout << "Counted loops will be unrolled " << unroll_factor
+                 << " times.\n" << flush;
+            break;
         case 'y':
             cout << "Symbol table will be printed after compilation.\n";
             print_symtab = true;
@@ -103,7 +130,8 @@ int main(int argc, char **argv)
         usage(argv[0]);
     } else if (optind == argc) {
         yyin = stdin;
-    } else {
+    } else if (!scanner_map_file(argv[optind])) {
+        // Not a regular file, so read it the ordinary way.
         yyin = fopen(argv[optind], "r");
         if (yyin == NULL) {
             perror(argv[optind]);
@@ -1,21 +1,149 @@
+#include <climits>
+#include <cmath>
+
 #include "optimize.hh"
 
 /*** This file contains all code pertaining to AST optimisation. It currently
-     implements a simple optimisation called "constant folding". Most of the
-     methods in this file are empty, or just relay optimize calls downward
-     in the AST. If a more powerful AST optimization scheme were to be
-     implemented, only methods in this file should need to be changed. ***/
+     implements constant propagation and a simple optimisation called
+     "constant folding". Most of the methods in this file are empty, or just
+     relay optimize calls downward in the AST. If a more powerful AST
+     optimization scheme were to be implemented, only methods in this file
+     should need to be changed. ***/
 
 
 ast_optimizer *optimizer = new ast_optimizer();
 
 
+/* Constructor. The tables are allocated the first time they are needed. */
+ast_optimizer::ast_optimizer()
+{
+    local_level = 0;
+    assign_count = NULL;
+    outer_assigned = NULL;
+    known_value = NULL;
+    table_size = 0;
+}
+
+
 /* The optimizer's interface method. Starts a recursive optimize call down
-   the AST nodes, searching for binary operators with constant children. */
+   the AST nodes, searching for binary operators with constant children.
+   The assignments in the body are counted first, so we know which local
+   variables are assigned only once. The top-level statements are then
+   optimized one by one here instead of through ast_stmt_list::optimize().
+   An assignment on this level is always executed before the statements
+   following it, so if it assigns a constant to a variable that is never
+   assigned anywhere else, the variable can be replaced by the constant in
+   the rest of the body. */
 void ast_optimizer::do_optimize(ast_stmt_list *body)
 {
-    if (body != NULL) {
-        body->optimize();
+    if (body == NULL) {
+        return;
+    }
+
+    sym_index env = sym_tab->current_environment();
+    local_level = sym_tab->get_symbol_level(env) + 1;
+    body->count_assignments();
+
+    // As in ast_stmt_list::optimize(), but a statement may be replaced by
+    // several, which all need to be looked at.
+    ast_statement **stmts = body->stmts;
+    int nr_stmts = body->nr_stmts;
+    body->stmts = NULL;
+    body->nr_stmts = 0;
+    body->stmts_size = 0;
+
+    for (int i = 0; i < nr_stmts; i++) {
+        if (stmts[i] != NULL) {
+            stmts[i]->optimize();
+            int first = body->nr_stmts;
+            append_pruned(body, stmts[i]);
+            for (int j = first; j < body->nr_stmts; j++) {
+                propagate_assignment(body->stmts[j]);
+            }
+        }
+    }
+}
+
+
+/* Make sure sym_p is a valid index in the propagation tables. New entries
+   are cleared. */
+void ast_optimizer::grow_tables(sym_index sym_p)
+{
+    if (sym_p < table_size) {
+        return;
+    }
+    int new_size = table_size == 0 ? 1024 : table_size;
+    while (new_size <= sym_p) {
+        new_size *= 2;
+    }
+
+    int *new_count = new int[new_size];
+    bool *new_outer = new bool[new_size];
+    ast_expression **new_known = new ast_expression *[new_size];
+    for (int i = 0; i < new_size; i++) {
+        new_count[i] = i < table_size ? assign_count[i] : 0;
+        new_outer[i] = i < table_size ? outer_assigned[i] : false;
+        new_known[i] = i < table_size ? known_value[i] : NULL;
+    }
+    delete[] assign_count;
+    delete[] outer_assigned;
+    delete[] known_value;
+    assign_count = new_count;
+    outer_assigned = new_outer;
+    known_value = new_known;
+    table_size = new_size;
+}
+
+
+/* Called for each assignment in the block being optimized. Only plain
+   variables are of interest, array elements are never propagated.
+   Assignments to variables of enclosing blocks are remembered for good,
+   since the enclosing block is optimized after this one. */
+void ast_optimizer::note_assignment(ast_lvalue *lhs)
+{
+    if (lhs->tag != AST_ID) {
+        return;
+    }
+    sym_index sym_p = lhs->get_ast_id()->sym_p;
+    grow_tables(sym_p);
+    if (sym_tab->get_symbol_level(sym_p) < local_level) {
+        outer_assigned[sym_p] = true;
+    } else {
+        assign_count[sym_p]++;
+    }
+}
+
+
+/* Called for each (already optimized) top-level statement of the block.
+   If it assigns a literal to a local variable which is assigned nowhere
+   else, the literal is remembered so that fold_constants() can replace
+   later uses of the variable with it. */
+void ast_optimizer::propagate_assignment(ast_statement *stmt)
+{
+    if (stmt->tag != AST_ASSIGN) {
+        return;
+    }
+    ast_assign *assign = (ast_assign *) stmt;
+    if (assign->lhs->tag != AST_ID) {
+        return;
+    }
+
+    sym_index sym_p = assign->lhs->get_ast_id()->sym_p;
+    if (sym_tab->get_symbol_tag(sym_p) != SYM_VAR ||
+        sym_tab->get_symbol_level(sym_p) != local_level) {
+        return;
+    }
+    grow_tables(sym_p);
+    if (assign_count[sym_p] != 1 || outer_assigned[sym_p]) {
+        return;
+    }
+
+    // A real variable assigned an integer literal has a cast on the right
+    // hand side, so it is not propagated.
+    sym_index type = sym_tab->get_symbol_type(sym_p);
+    if ((assign->rhs->tag == AST_INTEGER && type == integer_type) ||
+        (assign->rhs->tag == AST_REAL && type == real_type)) {
+        known_value[sym_p] = assign->rhs;
     }
 }
 
@@ -82,11 +210,19 @@ void ast_binaryrelation::optimize()
 /* Optimize a statement list. */
 void ast_stmt_list::optimize()
 {
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_stmt != NULL) {
-        last_stmt->optimize();
+    // The statements are moved to a new array, without the parts that can
+    // never be executed.
+    ast_statement **old_stmts = stmts;
+    int old_nr_stmts = nr_stmts;
+    stmts = NULL;
+    nr_stmts = 0;
+    stmts_size = 0;
+
+    for (int i = 0; i < old_nr_stmts; i++) {
+        if (old_stmts[i] != NULL) {
+            old_stmts[i]->optimize();
+            optimizer->append_pruned(this, old_stmts[i]);
+        }
     }
 }
 
@@ -95,13 +231,12 @@ void ast_stmt_list::optimize()
 void ast_expr_list::optimize()
 {
     /* Your code here */
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_expr != NULL) {
-        last_expr->optimize();
+    for (int i = 0; i < nr_exprs; i++) {
+        if (exprs[i] != NULL) {
+            exprs[i]->optimize();
+            exprs[i] = optimizer->fold_constants(exprs[i]);
+        }
     }
-
 }
 
 
@@ -109,11 +244,10 @@ void ast_expr_list::optimize()
 void ast_elsif_list::optimize()
 {
     /* Your code here */
-    if (preceding != NULL) {
-        preceding->optimize();
-    }
-    if (last_elsif != NULL) {
-        last_elsif->optimize();
+    for (int i = 0; i < nr_elsifs; i++) {
+        if (elsifs[i] != NULL) {
+            elsifs[i]->optimize();
+        }
     }
 }
 
@@ -130,6 +264,7 @@ void ast_indexed::optimize()
 {
     /* Your code here */
     index->optimize();
+    index = optimizer->fold_constants(index);
 }
 
 // Our own implementation
@@ -142,15 +277,20 @@ void ast_optimizer::ghett0_optimize_binop(ast_binaryoperation *node)
 }
 
 /* This convenience method is used to apply constant folding to all
-   binary operations. It returns either the resulting optimized node or the
-   original node if no optimization could be performed. */
+   expressions. It returns either the resulting optimized node or the
+   original node if no optimization could be performed. Children are
+   optimized before their parents, so only nodes whose operands are already
+   literals need to be looked at. */
 ast_expression *ast_optimizer::fold_constants(ast_expression *node)
 {
     /* Your code here */
-    /*if (node->tag == AST_ID)
+    // Named constants, and variables with a known value, are replaced by a
+    // literal. Each use gets a literal node of its own.
+    if (node->tag == AST_ID)
     {
         ast_id *id = node->get_ast_id();
-        if (sym_tab->get_symbol_tag(id->sym_p) == SYM_CONST)
+        sym_type tag = sym_tab->get_symbol_tag(id->sym_p);
+        if (tag == SYM_CONST)
         {
             constant_symbol *sym = sym_tab->get_symbol(id->sym_p)->get_constant_symbol();
             if (sym->type == integer_type)
@@ -162,111 +302,392 @@ ast_expression *ast_optimizer::fold_constants(ast_expression *node)
                 return new ast_real(id->pos, sym->const_value.rval);
             }
         }
-    }*/
+        if (tag == SYM_VAR && id->sym_p < table_size &&
+            known_value[id->sym_p] != NULL)
+        {
+            ast_expression *value = known_value[id->sym_p];
+            if (value->tag == AST_INTEGER)
+            {
+                return new ast_integer(id->pos, value->get_ast_integer()->value);
+            }
+            else
+            {
+                return new ast_real(id->pos, value->get_ast_real()->value);
+            }
+        }
+        return node;
+    }
 
-    if ( is_binop(node) )
-    {
-        ast_binaryoperation *binop = node->get_ast_binaryoperation();
-        ast_expression *l = binop->left;
-        ast_expression *r = binop->right;
+    switch (node->tag) {
+    case AST_ADD:
+    case AST_SUB:
+    case AST_OR:
+    case AST_AND:
+    case AST_MULT:
+    case AST_DIVIDE:
+    case AST_IDIV:
+    case AST_MOD:
+        return fold_binop(node->get_ast_binaryoperation());
+
+    case AST_EQUAL:
+    case AST_NOTEQUAL:
+    case AST_LESSTHAN:
+    case AST_GREATERTHAN:
+        return fold_binrel((ast_binaryrelation *) node);
+
+    case AST_NOT: {
+        ast_not *n = (ast_not *) node;
+        if (n->expr->tag == AST_INTEGER) {
+            return new ast_integer(n->pos, n->expr->get_ast_integer()->value == 0);
+        }
+        break;
+    }
+    case AST_UMINUS: {
+        ast_uminus *n = (ast_uminus *) node;
+        if (n->expr->tag == AST_INTEGER) {
+            unsigned long value = n->expr->get_ast_integer()->value;
+            return new ast_integer(n->pos, (long) -value);
+        }
+        if (n->expr->tag == AST_REAL) {
+            return new ast_real(n->pos, -n->expr->get_ast_real()->value);
+        }
+        break;
+    }
+    case AST_CAST: {
+        ast_cast *n = node->get_ast_cast();
+        if (n->expr->tag == AST_INTEGER) {
+            return new ast_real(n->pos, n->expr->get_ast_integer()->value);
+        }
+        break;
+    }
+    default:
+        break;
+    }
 
+    return node;
+}
 
-        switch (node->tag) {
-        case AST_ADD:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value + r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_INTEGER && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_integer()->value + r->get_ast_real()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_INTEGER) {
-                return new ast_real(l->pos, l->get_ast_real()->value + r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_real()->value + r->get_ast_real()->value);
-            }
-            break;
-        case AST_SUB:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value - r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_INTEGER && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_integer()->value - r->get_ast_real()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_INTEGER) {
-                return new ast_real(l->pos, l->get_ast_real()->value - r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_real()->value - r->get_ast_real()->value);
-            }
-            break;
-        case AST_OR:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value or r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_INTEGER && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_integer()->value or r->get_ast_real()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_INTEGER) {
-                return new ast_real(l->pos, l->get_ast_real()->value or r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_real()->value or r->get_ast_real()->value);
-            }
-            break;
-        case AST_AND:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value and r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_INTEGER && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_integer()->value and r->get_ast_real()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_INTEGER) {
-                return new ast_real(l->pos, l->get_ast_real()->value and r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_real()->value and r->get_ast_real()->value);
-            }
-            break;
-        case AST_MULT:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value * r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_INTEGER && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_integer()->value * r->get_ast_real()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_INTEGER) {
-                return new ast_real(l->pos, l->get_ast_real()->value * r->get_ast_integer()->value);
-            }
-            else if (l->tag == AST_REAL && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_real()->value * r->get_ast_real()->value);
-            }
-            break;
-        case AST_DIVIDE:
-            if (l->tag == AST_REAL && r->tag == AST_REAL) {
-                return new ast_real(l->pos, l->get_ast_real()->value / r->get_ast_real()->value);
-            }
-            break;
-        case AST_IDIV:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value / r->get_ast_integer()->value);
-            }
-            break;
-        case AST_MOD:
-            if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
-                return new ast_integer(l->pos, l->get_ast_integer()->value % r->get_ast_integer()->value);
-            }
-            break;
-        default:
-            break;
+
+/* Evaluate an integer operation the way the generated code would. The
+   arithmetic wraps around like the 64-bit machine instructions do. Division
+   by zero, and the one division that overflows, trap at run time, so they
+   are left for run time. Returns false if the operation can't be folded. */
+static bool fold_integer_op(ast_node_type op, long l, long r, long *result)
+{
+    unsigned long ul = l;
+    unsigned long ur = r;
+
+    switch (op) {
+    case AST_ADD:
+        *result = (long) (ul + ur);
+        return true;
+    case AST_SUB:
+        *result = (long) (ul - ur);
+        return true;
+    case AST_MULT:
+        *result = (long) (ul * ur);
+        return true;
+    case AST_OR:
+        *result = l != 0 || r != 0;
+        return true;
+    case AST_AND:
+        *result = l != 0 && r != 0;
+        return true;
+    case AST_IDIV:
+    case AST_MOD:
+        if (r == 0 || (l == LONG_MIN && r == -1)) {
+            return false;
+        }
+        // Like idiv, C++ truncates towards zero.
+        *result = op == AST_IDIV ? l / r : l % r;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/* Same as above for real operations. Division by zero is left for run time
+   as well. */
+static bool fold_real_op(ast_node_type op, double l, double r, double *result)
+{
+    switch (op) {
+    case AST_ADD:
+        *result = l + r;
+        return true;
+    case AST_SUB:
+        *result = l - r;
+        return true;
+    case AST_MULT:
+        *result = l * r;
+        return true;
+    case AST_DIVIDE:
+        if (r == 0) {
+            return false;
+        }
+        *result = l / r;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/* Returns true if node is an integer or real literal, and its value as a
+   real in value. */
+static bool get_real_literal(ast_expression *node, double *value)
+{
+    if (node->tag == AST_INTEGER) {
+        *value = node->get_ast_integer()->value;
+        return true;
+    }
+    if (node->tag == AST_REAL) {
+        *value = node->get_ast_real()->value;
+        return true;
+    }
+    return false;
+}
+
+
+/* Evaluate a relation. Both operands have the same type. */
+template <class T>
+static long fold_relation(ast_node_type op, T l, T r)
+{
+    switch (op) {
+    case AST_EQUAL:
+        return l == r;
+    case AST_NOTEQUAL:
+        return l != r;
+    case AST_LESSTHAN:
+        return l < r;
+    default:
+        return l > r;
+    }
+}
+
+
+/* Fold a binary operation with two literal operands. After type checking
+   both operands have the same type, except for the integer-only operators
+   which are never given reals. */
+ast_expression *ast_optimizer::fold_binop(ast_binaryoperation *node)
+{
+    ast_expression *l = node->left;
+    ast_expression *r = node->right;
+
+    if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
+        long result;
+        if (fold_integer_op(node->tag,
+                            l->get_ast_integer()->value,
+                            r->get_ast_integer()->value,
+                            &result)) {
+            return new ast_integer(node->pos, result);
         }
-        
+        return node;
+    }
+
+    double lval, rval, result;
+    if (get_real_literal(l, &lval) && get_real_literal(r, &rval) &&
+        fold_real_op(node->tag, lval, rval, &result)) {
+        return new ast_real(node->pos, result);
     }
+    return simplify_binop(node);
+}
+
 
+/* Returns true if evaluating node can't have side effects or trap, so that
+   it may be thrown away. Kept simple: only identifiers and literals. */
+static bool is_pure(ast_expression *node)
+{
+    return node->tag == AST_ID ||
+           node->tag == AST_INTEGER ||
+           node->tag == AST_REAL;
+}
+
+
+/* Returns true if node is the integer literal value. */
+static bool is_integer(ast_expression *node, long value)
+{
+    return node->tag == AST_INTEGER && node->get_ast_integer()->value == value;
+}
 
+
+/* Algebraic identities for integer operations that couldn't be folded:
+   x + 0, 0 + x, x - 0, x * 1, 1 * x and x div 1 are x, and x - x, x * 0,
+   0 * x and x mod 1 are 0. An operand is only dropped if it is pure. Real
+   operations are left alone, since the identities don't hold for infinities
+   and NaN. Multiplication, div and mod by other powers of two are strength
+   reduced when generating quads, see quads.cc. */
+ast_expression *ast_optimizer::simplify_binop(ast_binaryoperation *node)
+{
+    if (node->type != integer_type) {
+        return node;
+    }
+    ast_expression *l = node->left;
+    ast_expression *r = node->right;
+
+    switch (node->tag) {
+    case AST_ADD:
+        if (is_integer(r, 0)) {
+            return l;
+        }
+        if (is_integer(l, 0)) {
+            return r;
+        }
+        break;
+    case AST_SUB:
+        if (is_integer(r, 0)) {
+            return l;
+        }
+        if (l->tag == AST_ID && r->tag == AST_ID &&
+            l->get_ast_id()->sym_p == r->get_ast_id()->sym_p) {
+            return new ast_integer(node->pos, 0);
+        }
+        break;
+    case AST_MULT:
+        if (is_integer(r, 1)) {
+            return l;
+        }
+        if (is_integer(l, 1)) {
+            return r;
+        }
+        if ((is_integer(r, 0) && is_pure(l)) ||
+            (is_integer(l, 0) && is_pure(r))) {
+            return new ast_integer(node->pos, 0);
+        }
+        break;
+    case AST_IDIV:
+        if (is_integer(r, 1)) {
+            return l;
+        }
+        break;
+    case AST_MOD:
+        if (is_integer(r, 1) && is_pure(l)) {
+            return new ast_integer(node->pos, 0);
+        }
+        break;
+    default:
+        break;
+    }
     return node;
 }
 
+
+/* Fold a relation with two literal operands. The result is 1 or 0, like
+   the generated code produces. Real comparisons involving NaN are left
+   alone, since the x87 code doesn't agree with C++ about them. */
+ast_expression *ast_optimizer::fold_binrel(ast_binaryrelation *node)
+{
+    ast_expression *l = node->left;
+    ast_expression *r = node->right;
+
+    if (l->tag == AST_INTEGER && r->tag == AST_INTEGER) {
+        return new ast_integer(node->pos,
+                               fold_relation(node->tag,
+                                             l->get_ast_integer()->value,
+                                             r->get_ast_integer()->value));
+    }
+
+    double lval, rval;
+    if (get_real_literal(l, &lval) && get_real_literal(r, &rval) &&
+        !isnan(lval) && !isnan(rval)) {
+        return new ast_integer(node->pos, fold_relation(node->tag, lval, rval));
+    }
+    return node;
+}
+
+
+/* Returns true if a condition is a literal, and whether it is true in
+   value. */
+static bool is_constant_condition(ast_expression *condition, bool *value)
+{
+    if (condition->tag != AST_INTEGER) {
+        return false;
+    }
+    *value = condition->get_ast_integer()->value != 0;
+    return true;
+}
+
+
+/* Append the statements of a block to a statement list. */
+static void append_all(ast_stmt_list *list, ast_stmt_list *block)
+{
+    if (block == NULL) {
+        return;
+    }
+    for (int i = 0; i < block->nr_stmts; i++) {
+        list->append(block->stmts[i]);
+    }
+}
+
+
+/* Append an (optimized) statement to a statement list, leaving out the
+   parts of it that can never be executed now that its conditions have been
+   folded. A while loop with a false condition is dropped altogether. */
+void ast_optimizer::append_pruned(ast_stmt_list *list, ast_statement *stmt)
+{
+    bool value;
+
+    if (stmt->tag == AST_WHILE) {
+        ast_while *loop = (ast_while *) stmt;
+        if (is_constant_condition(loop->condition, &value) && !value) {
+            return;
+        }
+    } else if (stmt->tag == AST_IF) {
+        prune_if(list, (ast_if *) stmt);
+        return;
+    }
+    list->append(stmt);
+}
+
+
+/* Remove the arms of an if statement that are never taken. The arms are
+   tried in order: one with a false condition is dropped, and one with a
+   true condition becomes the else part, dropping the arms after it. The
+   first arm left becomes the if arm. If there is none, the if statement is
+   replaced by its else part. */
+void ast_optimizer::prune_if(ast_stmt_list *list, ast_if *node)
+{
+    int nr_elsifs = node->elsif_list != NULL ? node->elsif_list->nr_elsifs : 0;
+    ast_stmt_list *else_body = node->else_body;
+    ast_elsif_list *kept = NULL;
+    bool have_if_arm = false;
+
+    // Arm -1 is the if arm itself.
+    for (int i = -1; i < nr_elsifs; i++) {
+        ast_elsif *elsif = i < 0 ? NULL : node->elsif_list->elsifs[i];
+        ast_expression *condition = i < 0 ? node->condition : elsif->condition;
+        ast_stmt_list *body = i < 0 ? node->body : elsif->body;
+
+        bool value;
+        if (is_constant_condition(condition, &value)) {
+            if (value) {
+                else_body = body;
+                break;
+            }
+            continue;
+        }
+
+        if (!have_if_arm) {
+            node->condition = condition;
+            node->body = body;
+            have_if_arm = true;
+        } else if (kept == NULL) {
+            kept = new ast_elsif_list(elsif->pos, elsif);
+        } else {
+            kept->append(elsif);
+        }
+    }
+
+    if (!have_if_arm) {
+        append_all(list, else_body);
+        return;
+    }
+    node->elsif_list = kept;
+    node->else_body = else_body;
+    list->append(node);
+}
+
+
 /* All the binary operations should already have been detected in their parent
    nodes, so we don't need to do anything at all here. */
 void ast_add::optimize()
@@ -374,6 +795,7 @@ void ast_procedurecall::optimize()
 void ast_assign::optimize()
 {
     /* Your code here */
+    lhs->optimize();
     rhs->optimize();
     rhs = optimizer->fold_constants(rhs);
 
@@ -385,7 +807,10 @@ void ast_while::optimize()
     /* Your code here */
     condition->optimize();
     condition = optimizer->fold_constants(condition);
-    body->optimize();
+    if (body != NULL)
+    {
+        body->optimize();
+    }
 }
 
 
@@ -394,7 +819,10 @@ void ast_if::optimize()
     /* Your code here */
     condition->optimize();
     condition = optimizer->fold_constants(condition);
-    body->optimize();
+    if (body != NULL)
+    {
+        body->optimize();
+    }
     if (elsif_list != NULL)
     {
         elsif_list->optimize();
@@ -468,6 +896,65 @@ void ast_real::optimize()
 void ast_cast::optimize()
 {
     /* Your code here */
+    expr->optimize();
+    expr = optimizer->fold_constants(expr);
+}
+
+
+
+/*** Assignment counting, used for constant propagation. ***/
+
+/* Most nodes can't contain assignments. */
+void ast_node::count_assignments()
+{
+}
+
+void ast_stmt_list::count_assignments()
+{
+    for (int i = 0; i < nr_stmts; i++) {
+        if (stmts[i] != NULL) {
+            stmts[i]->count_assignments();
+        }
+    }
+}
+
+void ast_elsif_list::count_assignments()
+{
+    for (int i = 0; i < nr_elsifs; i++) {
+        elsifs[i]->count_assignments();
+    }
+}
+
+void ast_elsif::count_assignments()
+{
+    if (body != NULL) {
+        body->count_assignments();
+    }
+}
+
+void ast_assign::count_assignments()
+{
+    optimizer->note_assignment(lhs);
+}
+
+void ast_while::count_assignments()
+{
+    if (body != NULL) {
+        body->count_assignments();
+    }
+}
+
+void ast_if::count_assignments()
+{
+    if (body != NULL) {
+        body->count_assignments();
+    }
+    if (elsif_list != NULL) {
+        elsif_list->count_assignments();
+    }
+    if (else_body != NULL) {
+        else_body->count_assignments();
+    }
 }
 
 
@@ -4,12 +4,15 @@
 #include "ast.hh"
 
 
-/*** This class performs AST optimisation. Currently it only implements a
-     very simple optimisation known as constant folding, which means that it
-     tries to evaluate a binary operation node such as 2 + 5 during compiling,
-     replacing it with a single integer node with value 7, or an expression
-     only involving constants, such as (assuming FOO = 2) 4 + FOO, replacing
-     the + node with an integer node with the value 6. ***/
+/*** This class performs AST optimisation. It implements constant folding,
+     which means that it tries to evaluate a binary operation node such as
+     2 + 5 during compiling, replacing it with a single integer node with
+     value 7, or an expression only involving constants, such as (assuming
+     FOO = 2) 4 + FOO, replacing the + node with an integer node with the
+     value 6. Before folding, identifiers are replaced by their values if
+     they are named constants, or local variables assigned a constant exactly
+     once before they are used. Statements that can never be executed
+     because of a folded condition are removed. ***/
 
 
 class ast_optimizer;
@@ -22,8 +25,42 @@ class ast_optimizer
 {
 /* You might want to add your own methods to this header file when
    solving the optimization lab. */
-    
+private:
+    // The block level of the local variables of the block being optimized.
+    block_level local_level;
+
+    // These tables are indexed by sym_index, and grown as needed.
+    // Nr of assignments to each local variable of the current block.
+    int *assign_count;
+
+    // Set for variables assigned from a block nested inside the one they
+    // were declared in. Such a variable may change behind our back whenever
+    // a subprogram is called, so it is never propagated.
+    bool *outer_assigned;
+
+    // The literal a local variable is known to hold, or NULL.
+    ast_expression **known_value;
+
+    int table_size;
+
+    // Make sure sym_p fits in the tables above.
+    void grow_tables(sym_index);
+
+    // Remember the value of a top-level assignment if it can be propagated.
+    void propagate_assignment(ast_statement *);
+
+    // Folding of the various kinds of expressions, see fold_constants().
+    ast_expression *fold_binop(ast_binaryoperation *);
+
+    ast_expression *simplify_binop(ast_binaryoperation *);
+
+    ast_expression *fold_binrel(ast_binaryrelation *);
+
+    // Removal of if arms that are never taken, see append_pruned().
+    void prune_if(ast_stmt_list *, ast_if *);
+
 public:
+    ast_optimizer();
 
     // This is the interface to parser.y. Sending in a function body as
     // arguments performs (destructive) optimization on it.
@@ -38,6 +75,12 @@ public:
     // a static method in the optimize.cc file... A matter of preference.
     ast_expression *fold_constants(ast_expression *);
 
+    // Called by ast_assign::count_assignments() for each assignment.
+    void note_assignment(ast_lvalue *);
+
+    // Used by the statement lists to drop code that can't be executed.
+    void append_pruned(ast_stmt_list *, ast_statement *);
+
 
     void ghett0_optimize_binop(ast_binaryoperation *);
 };
@@ -3,6 +3,8 @@
 #include "semantic.hh"
 #include "optimize.hh"
 #include "codegen.hh"
+#include "cfg.hh"
+#include "quadopt.hh"
 
 /* Defined in parser.cc */
 extern char *yytext;
@@ -30,10 +32,12 @@ extern void yyerror(string);
    given to the 'diesel' script. */
 extern bool print_ast;
 extern bool print_quads;
+extern bool print_flow;
 extern bool typecheck;
 extern bool optimize;
 extern bool quads;
 extern bool assembler;
+extern bool bounds_check;
 
 
 
@@ -157,10 +161,31 @@ program         : prog_decl subprog_part comp_stmt T_DOT
                     if (error_count == 0) {
                         if (quads) {
                             quad_list *q = $1->do_quads($3);
+                            if (optimize) {
+                                q = quad_opt->do_optimize(q);
+                            } else if (bounds_check) {
+                                quad_opt->count_bounds_checks(q);
+                            }
+                            if (bounds_check && quad_opt->nr_checks > 0) {
+                                cout << "Bounds checks for global level: "
+                                     << quad_opt->nr_checks_left << " of "
+                                     << quad_opt->nr_checks << " left, "
+                                     << quad_opt->nr_checks_in_loops
+                                     << " in loops" << endl;
+                            }
                             if (print_quads) {
                                 cout << "\nQuad list for global level" << endl;
                                 cout << (quad_list *)q << endl;
                             }
+                            if (print_flow) {
+                                control_flow_graph *g =
+                                    new control_flow_graph(q);
+                                cout << "\nControl flow graph for global level"
+                                     << endl;
+                                cout << g;
+                                g->print_statistics(cout);
+                                delete g;
+                            }
 
                             if (assembler) {
                                 cout << "Generating assembler, global level"
@@ -173,8 +198,9 @@ program         : prog_decl subprog_part comp_stmt T_DOT
                              << "Compilation aborted.\n";
                     }
 
-                    // We close the global scope.
+                    // We close the global scope, and free the AST.
                     sym_tab->close_scope();
+                    pop_block_arena();
 
                 }
                 ;
@@ -193,8 +219,11 @@ prog_head       : T_PROGRAM T_IDENT
                 {
                     /* Your code here */
                     print_debug("prog_head\n");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    // Everything in this block's AST is allocated from its
+                    // own arena, freed when the block has been compiled.
+                    push_block_arena();
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     sym_index sym_p = sym_tab->enter_procedure(pos, $2);
                     $$ = new ast_procedurehead(pos,sym_p);
@@ -220,8 +249,8 @@ const_decls     : const_decl
 const_decl      : T_IDENT T_EQ integer T_SEMICOLON
                 {
                     print_debug("Const decl 1\n");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     sym_index sym_p = sym_tab->enter_constant(pos, $1, integer_type, $3->value);
                     
@@ -231,8 +260,8 @@ const_decl      : T_IDENT T_EQ integer T_SEMICOLON
                 {
                     /* Your code here */
 
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     sym_index sym_p = sym_tab->enter_constant(pos, $1, real_type, $3->value);
 
@@ -252,8 +281,8 @@ const_decl      : T_IDENT T_EQ integer T_SEMICOLON
                     // ...now, why would anyone want to do that?
                     /* Your code here */
                     //TODO: FIX
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     constant_symbol *cs = sym_tab->get_symbol($3->sym_p)->get_constant_symbol();
                     if ($3->type == integer_type)
@@ -289,8 +318,8 @@ var_decl        : T_IDENT T_COLON type_id T_SEMICOLON
                 {
                     /* Your code here */
                     print_debug("var_decl 1 START\n");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column); 
                     sym_tab->enter_variable(pos, $1, $3->sym_p);
                     print_debug("var_decl 1 DONE\n");
@@ -300,8 +329,8 @@ var_decl        : T_IDENT T_COLON type_id T_SEMICOLON
                 {
                     /* Your code here */
                     print_debug("var_decl 2 START\n");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     sym_tab->enter_array(pos,
                                          $1,
@@ -316,8 +345,8 @@ var_decl        : T_IDENT T_COLON type_id T_SEMICOLON
                     // We enter an array: pool_pointer, type pointer,
                     // the id type of the constant, and the value of the
                     // constant.
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
 
                     // Ideally we should be able to just enter the array and
@@ -411,12 +440,36 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                     if (error_count == 0) {
                         if (quads) {
                             quad_list *q = $1->do_quads($3);
+                            if (optimize) {
+                                q = quad_opt->do_optimize(q);
+                            } else if (bounds_check) {
+                                quad_opt->count_bounds_checks(q);
+                            }
+                            if (bounds_check && quad_opt->nr_checks > 0) {
+                                cout << "Bounds checks for \""
+                                     << sym_tab->pool_lookup(env->id)
+                                     << "\": "
+                                     << quad_opt->nr_checks_left << " of "
+                                     << quad_opt->nr_checks << " left, "
+                                     << quad_opt->nr_checks_in_loops
+                                     << " in loops" << endl;
+                            }
                             if (print_quads) {
                                 cout << "\nQuad list for \""
                                      << sym_tab->pool_lookup(env->id)
                                      << "\"" << endl;
                                 cout << (quad_list *)q << endl;
                             }
+                            if (print_flow) {
+                                control_flow_graph *g =
+                                    new control_flow_graph(q);
+                                cout << "\nControl flow graph for \""
+                                     << sym_tab->pool_lookup(env->id)
+                                     << "\"" << endl;
+                                cout << g;
+                                g->print_statistics(cout);
+                                delete g;
+                            }
 
                             if (assembler) {
                                 cout << "Generating assembler for procedure \""
@@ -427,8 +480,9 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                         }
                     }
 
-                    // Close the current scope.
+                    // Close the current scope, and free the AST.
                     sym_tab->close_scope();
+                    pop_block_arena();
                     print_debug("subprog_decl 1 DONE\n");
                 }
                 | func_decl subprog_part comp_stmt T_SEMICOLON
@@ -460,12 +514,36 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                     if (error_count == 0) {
                         if (quads) {
                             quad_list *q = $1->do_quads($3);
+                            if (optimize) {
+                                q = quad_opt->do_optimize(q);
+                            } else if (bounds_check) {
+                                quad_opt->count_bounds_checks(q);
+                            }
+                            if (bounds_check && quad_opt->nr_checks > 0) {
+                                cout << "Bounds checks for \""
+                                     << sym_tab->pool_lookup(env->id)
+                                     << "\": "
+                                     << quad_opt->nr_checks_left << " of "
+                                     << quad_opt->nr_checks << " left, "
+                                     << quad_opt->nr_checks_in_loops
+                                     << " in loops" << endl;
+                            }
                             if (print_quads) {
                                 cout << "\nQuad list for \""
                                      << sym_tab->pool_lookup(env->id)
                                      << "\"" << endl;
                                 cout << (quad_list *)q << endl;
                             }
+                            if (print_flow) {
+                                control_flow_graph *g =
+                                    new control_flow_graph(q);
+                                cout << "\nControl flow graph for \""
+                                     << sym_tab->pool_lookup(env->id)
+                                     << "\"" << endl;
+                                cout << g;
+                                g->print_statistics(cout);
+                                delete g;
+                            }
 
                             if (assembler) {
                                 cout << "Generating assembler for function \""
@@ -476,8 +554,9 @@ subprog_decl    : proc_decl subprog_part comp_stmt T_SEMICOLON
                         }
                     }
 
-                    // Close the current scope.
+                    // Close the current scope, and free the AST.
                     sym_tab->close_scope();
+                    pop_block_arena();
                     print_debug("subprog_decl 2 DONE\n");
                 }
                 ;
@@ -496,7 +575,7 @@ func_decl       : func_head opt_param_list T_COLON type_id T_SEMICOLON const_par
                 {
                     /* Your code here */
                     print_debug("func_decl START\n");
-                    sym_tab->get_symbol($1->sym_p)->type = $4->sym_p;
+                    sym_tab->set_symbol_type($1->sym_p, $4->sym_p);
                     $$ = $1;
                     print_debug("func_decl DONE\n");
                 }
@@ -506,8 +585,11 @@ func_decl       : func_head opt_param_list T_COLON type_id T_SEMICOLON const_par
 proc_head       : T_PROCEDURE T_IDENT
                 {
                     print_debug("proc_head START\n");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    // Everything in this block's AST is allocated from its
+                    // own arena, freed when the block has been compiled.
+                    push_block_arena();
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     // We add the function id to the symbol table.
                     sym_index proc_loc = sym_tab->enter_procedure(pos,
@@ -528,8 +610,11 @@ proc_head       : T_PROCEDURE T_IDENT
 func_head       : T_FUNCTION T_IDENT
                 {
                     print_debug("func_head START\n");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    // Everything in this block's AST is allocated from its
+                    // own arena, freed when the block has been compiled.
+                    push_block_arena();
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
                     // We add the function id to the symbol table.
                     sym_index func_loc = sym_tab->enter_function(pos,
@@ -581,8 +666,8 @@ param_list      : param
 param           : T_IDENT T_COLON type_id
                 {
                     print_debug("Parameter!");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
 
                     // Enter parameter into the symbol table. The linking of
@@ -632,7 +717,8 @@ stmt_list       : stmt
                     //cout << $1 << endl << endl;
                     if ($1 != NULL && $3 != NULL)
                     {
-                        $$ = new ast_stmt_list($1->pos, $3, $1);
+                        $1->append($3);
+                        $$ = $1;
                     }
                     else if( $3 != NULL )
                     {
@@ -655,8 +741,8 @@ stmt            : T_IF expr T_THEN stmt_list elsif_list else_part T_END
 
                     
                     print_debug("stmt 1");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
                     $$ = new ast_if(pos, $2, $4, $5, $6);
                 }
@@ -666,8 +752,8 @@ stmt            : T_IF expr T_THEN stmt_list elsif_list else_part T_END
                     
                     
                     print_debug("stmt 2");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
                     $$ = new ast_while(pos, $2, $4);
                 }
@@ -689,8 +775,8 @@ stmt            : T_IF expr T_THEN stmt_list elsif_list else_part T_END
                     /* Your code here */
                     
                     print_debug("stmt 5");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
                     $$ = new ast_return(pos, $2);
                 }
@@ -698,8 +784,8 @@ stmt            : T_IF expr T_THEN stmt_list elsif_list else_part T_END
                 {
                     /* Your code here */
                     print_debug("stmt 6");
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
                     $$ = new ast_return(pos);
                 }
@@ -762,7 +848,12 @@ rvariable       : rvar_id
 elsif_list      : elsif_list elsif
                 {
                     /* Your code here */
-                    $$ = new ast_elsif_list($2->pos, $2, $1);
+                    if ($1 != NULL) {
+                        $1->append($2);
+                        $$ = $1;
+                    } else {
+                        $$ = new ast_elsif_list($2->pos, $2);
+                    }
                 }
                 | /* empty */
                 {
@@ -777,8 +868,8 @@ elsif           : T_ELSIF expr T_THEN stmt_list
                     /* Your code here */
                     //TODO: open scope?
                     
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
                     $$ = new ast_elsif(pos, $2, $4);
                 }
@@ -823,7 +914,8 @@ expr_list       : expr
                 {
                     
                     /* Your code here */
-                    $$ = new ast_expr_list($1->pos, $3, $1);
+                    $1->append($3);
+                    $$ = $1;
                 }
                 ;
 
@@ -875,8 +967,8 @@ simple_expr     : term
                 | T_SUB term
                 {
                     /* Your code here */
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
                     $$ = new ast_uminus(pos, $2);
                 }
@@ -955,8 +1047,8 @@ factor          : rvariable
                 | T_NOT factor
                 {
                     /* Your code here */
-                   position_information *pos =
-                        new position_information(@1.first_line,
+                   position_information pos =
+                        position_information(@1.first_line,
                                              @1.first_column);
 
                     $$ = new ast_not(pos, $2);
@@ -987,8 +1079,8 @@ func_call       : func_id T_LEFTPAR opt_expr_list T_RIGHTPAR
 
 integer         : T_INTNUM
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
 
                     // We need to pass on the value AND the position here.
@@ -1000,8 +1092,8 @@ integer         : T_INTNUM
 
 real            : T_REALNUM
                 {
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
 
                     // We create a new real constant.
@@ -1115,8 +1207,8 @@ array_id        : id
 id              : T_IDENT
                 {
                     sym_index sym_p;    // Used to find previous use of symbol.
-                    position_information *pos =
-                        new position_information(@1.first_line,
+                    position_information pos =
+                        position_information(@1.first_line,
                                                  @1.first_column);
 
                     // Make sure the symbol was declared before it is used.
@@ -0,0 +1,2278 @@
+#include <string.h>
+#include <limits.h>
+
+#include "symtab.hh"
+#include "quadopt.hh"
+
+/*** This file contains the optimisations done on quads, after the AST has
+     been optimized and turned into a quad list. The passes work on the
+     control flow graph and dataflow analyses in cfg.cc. ***/
+
+
+quad_optimizer *quad_opt = new quad_optimizer();
+
+// The nr of copies of a loop body made by unroll_loops(), set with the -u
+// flag. 1 means no unrolling.
+extern int unroll_factor;
+
+// Set by the -r flag, see quads.cc.
+extern bool bounds_check;
+
+
+/* Constructor. The tables are allocated for each quad list. */
+quad_optimizer::quad_optimizer()
+{
+    cfg = NULL;
+    bodies = NULL;
+    bodies_size = 0;
+    tracked = NULL;
+    nr_tracked = 0;
+    nr_checks = 0;
+    nr_checks_left = 0;
+    nr_checks_in_loops = 0;
+    def_count = NULL;
+    use_count = NULL;
+    preheaders = NULL;
+}
+
+
+/* The interface method. Inlines the calls of a quad list and turns its tail
+   calls into jumps, builds the graph of it, runs the passes on it, and
+   returns a new quad list of what is left. Hoisting quads out of loops may
+   bring equal quads together in a pre-header, and unrolling makes copies of
+   loop bodies, so the local passes are run once more after them. The bounds
+   checks range analysis can do without are removed before that, so that
+   hoisting only sees the checks that are left, and unrolling doesn't copy
+   them. The result is kept for inlining if it is small enough. */
+quad_list *quad_optimizer::do_optimize(quad_list *q)
+{
+    q = inline_calls(q);
+    q = eliminate_tail_calls(q);
+    cfg = new control_flow_graph(q);
+
+    number_all_values();
+    remove_copies_and_dead_code();
+    if (bounds_check) {
+        remove_bounds_checks();
+        remove_nops();
+    }
+    bool changed = hoist_invariants();
+    if (unroll_factor > 1 && unroll_loops()) {
+        changed = true;
+    }
+    if (changed) {
+        number_all_values();
+        remove_copies_and_dead_code();
+    }
+
+    count_uses();
+    pack_frame();
+    delete[] def_count;
+    delete[] use_count;
+    def_count = NULL;
+    use_count = NULL;
+
+    quad_list *result = cfg->to_quad_list();
+    delete cfg;
+    cfg = NULL;
+    remember_body(sym_tab->current_environment(), result);
+    return result;
+}
+
+
+/* Number the values of all the blocks, see number_values(). */
+void quad_optimizer::number_all_values()
+{
+    start_numbering();
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        number_values(cfg->blocks[b]);
+    }
+    end_numbering();
+}
+
+
+/* The passes of the section below, in the order they are best run in. */
+void quad_optimizer::remove_copies_and_dead_code()
+{
+    count_uses();
+    propagate_copies();
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        coalesce_copies(cfg->blocks[b]);
+    }
+    while (eliminate_dead_code()) {
+        // Removing a quad may make the quads computing its operands dead.
+    }
+    remove_nops();
+}
+
+
+
+/*** Inlining. ***/
+
+/* Return the nr of parameters of a procedure or function. They are entered
+   right after it, so the first one is env + 1 and so on. This is checked
+   against the parameter list to be sure, and -1 is returned if it doesn't
+   hold. */
+int quad_optimizer::parameters_of(sym_index env)
+{
+    symbol *s = sym_tab->get_symbol(env);
+    parameter_symbol *last_param = s->tag == SYM_PROC ?
+        s->get_procedure_symbol()->last_parameter :
+        s->get_function_symbol()->last_parameter;
+    int nr_params = 0;
+    for (parameter_symbol *p = last_param; p != NULL; p = p->preceding) {
+        nr_params++;
+    }
+    int i = nr_params;
+    for (parameter_symbol *p = last_param; p != NULL; p = p->preceding) {
+        if (sym_tab->get_symbol(env + i) != p) {
+            return -1;
+        }
+        i--;
+    }
+    return nr_params;
+}
+
+
+/* Keep the optimized quads of a procedure or function if it can be inlined.
+   The body must be small, and it must not call a subprogram nested in it
+   or use a local array, since those need the body's own activation record.
+   Everything else the body uses is either local to it, and renamed at each
+   call, or declared at a level visible from every caller. The display of a
+   caller holds the same frames for those levels as the display the callee
+   would have copied from it, so the nonlocal accesses need no change. */
+void quad_optimizer::remember_body(sym_index env, quad_list *q)
+{
+    sym_type tag = sym_tab->get_symbol_tag(env);
+    if (tag != SYM_PROC && tag != SYM_FUNC) {
+        return;
+    }
+    block_level local_level = sym_tab->get_symbol_level(env) + 1;
+
+    int nr_quads = 0;
+    int size = 0;
+    quad_list_iterator it(q);
+    quadruple *last = NULL;
+    for (quadruple *quad = it.get_current(); quad != NULL;
+         quad = it.get_next()) {
+        nr_quads++;
+        last = quad;
+        switch (quad->op_code) {
+        case q_labl:
+            break;
+        case q_call:
+        case q_lindex:
+        case q_rrindex:
+        case q_irindex:
+            if (sym_tab->get_symbol_level(quad->sym1) >= local_level) {
+                return;
+            }
+            // Fall through.
+        default:
+            if (++size > MAX_INLINE_SIZE) {
+                return;
+            }
+        }
+    }
+
+    // The copies end with the label the returns jump to.
+    if (last == NULL || last->op_code != q_labl ||
+        last->int1 != q->last_label) {
+        return;
+    }
+
+    int nr_params = parameters_of(env);
+    if (nr_params < 0) {
+        return;
+    }
+
+    inline_body *body = new inline_body;
+    body->quads = new quadruple*[nr_quads];
+    body->nr_quads = 0;
+    body->last_label = q->last_label;
+    body->locals = new sym_index[nr_params + 3 * nr_quads];
+    body->nr_locals = 0;
+    body->nr_params = nr_params;
+    body->labels = new int[nr_quads];
+    body->nr_labels = 0;
+
+    for (int i = 0; i < nr_params; i++) {
+        body->locals[body->nr_locals++] = env + 1 + i;
+    }
+
+    quad_list_iterator it2(q);
+    for (quadruple *quad = it2.get_current(); quad != NULL;
+         quad = it2.get_next()) {
+        body->quads[body->nr_quads++] = quad;
+        if (quad->op_code == q_labl) {
+            body->labels[body->nr_labels++] = quad->int1;
+            continue;
+        }
+
+        sym_index syms[3];
+        int nr_syms = quad_operands(quad, syms);
+        if (quad_result(quad) != NULL_SYM) {
+            syms[nr_syms++] = quad_result(quad);
+        }
+        for (int j = 0; j < nr_syms; j++) {
+            sym_type sym_tag = sym_tab->get_symbol_tag(syms[j]);
+            if ((sym_tag != SYM_VAR && sym_tag != SYM_PARAM) ||
+                sym_tab->get_symbol_level(syms[j]) != local_level) {
+                continue;
+            }
+            int k = 0;
+            while (k < body->nr_locals && body->locals[k] != syms[j]) {
+                k++;
+            }
+            if (k == body->nr_locals) {
+                body->locals[body->nr_locals++] = syms[j];
+            }
+        }
+    }
+
+    if (env >= bodies_size) {
+        int new_size = bodies_size == 0 ? 64 : bodies_size;
+        while (new_size <= env) {
+            new_size *= 2;
+        }
+        inline_body **old_bodies = bodies;
+        bodies = new inline_body*[new_size];
+        for (int b = 0; b < new_size; b++) {
+            bodies[b] = b < bodies_size ? old_bodies[b] : NULL;
+        }
+        delete[] old_bodies;
+        bodies_size = new_size;
+    }
+    bodies[env] = body;
+}
+
+
+/* Return a new quad list with the calls to the remembered bodies replaced by
+   copies of them. The parameters of a call are found by keeping a stack of
+   the q_param quads seen, since the parameters of the calls made to compute
+   an argument are pushed and popped in between. The body of a subprogram
+   that called something inlined has those calls inlined already, so the
+   copies are not searched for calls. */
+quad_list *quad_optimizer::inline_calls(quad_list *q)
+{
+    if (bodies == NULL) {
+        return q;
+    }
+
+    quad_list *result = new quad_list(q->last_label);
+    int growth = 0;
+    int params_size = 16;
+    int nr_params = 0;
+    quadruple **params = new quadruple*[params_size];
+
+    quad_list_iterator it(q);
+    for (quadruple *quad = it.get_current(); quad != NULL;
+         quad = it.get_next()) {
+        if (quad->op_code != q_call) {
+            *result += quad;
+        }
+        if (quad->op_code == q_param) {
+            if (nr_params == params_size) {
+                quadruple **old_params = params;
+                params = new quadruple*[params_size * 2];
+                memcpy(params, old_params, params_size * sizeof(quadruple *));
+                delete[] old_params;
+                params_size *= 2;
+            }
+            params[nr_params++] = quad;
+            continue;
+        }
+        if (quad->op_code != q_call) {
+            continue;
+        }
+
+        if (quad->int2 > nr_params) {
+            fatal("Internal compiler error: call without parameters");
+        }
+        nr_params -= quad->int2;
+        inline_body *body = quad->sym1 < bodies_size ?
+            bodies[quad->sym1] : NULL;
+        if (body == NULL || body->nr_params != quad->int2 ||
+            growth + body->nr_quads > MAX_INLINE_GROWTH) {
+            *result += quad;
+            continue;
+        }
+        growth += body->nr_quads;
+        inline_call(*result, body, &params[nr_params], quad->sym3);
+    }
+
+    delete[] params;
+    return result;
+}
+
+
+/* Append a copy of a body to a quad list. The parameter quads of the call,
+   pushed last parameter first, become copies to the temporaries replacing
+   the parameters. A return becomes a copy to the result of the call and a
+   jump to the end of the copy. */
+void quad_optimizer::inline_call(quad_list &q, inline_body *body,
+                                 quadruple **params, sym_index result)
+{
+    // The bodies are small, so the new names are found by linear search.
+    sym_index *temps = new sym_index[body->nr_locals];
+    for (int i = 0; i < body->nr_locals; i++) {
+        temps[i] = sym_tab->gen_temp_var(
+            sym_tab->get_symbol_type(body->locals[i]));
+    }
+    int *labels = new int[body->nr_labels];
+    for (int i = 0; i < body->nr_labels; i++) {
+        labels[i] = sym_tab->get_next_label();
+    }
+
+    for (int i = 0; i < body->nr_params; i++) {
+        quadruple *param = params[body->nr_params - 1 - i];
+        if (sym_tab->get_symbol_type(temps[i]) == real_type) {
+            param->op_code = q_rassign;
+        } else {
+            param->op_code = q_iassign;
+        }
+        param->sym3 = param->int3 = temps[i];
+    }
+
+    for (int i = 0; i < body->nr_quads; i++) {
+        quadruple *quad = new quadruple(*body->quads[i]);
+
+        if (quad->op_code == q_labl || quad->op_code == q_jmp ||
+            quad->op_code == q_jmpf) {
+            int l = 0;
+            while (l < body->nr_labels && body->labels[l] != quad->int1) {
+                l++;
+            }
+            if (l == body->nr_labels) {
+                fatal("Internal compiler error: jump to unknown label");
+            }
+            quad->int1 = quad->sym1 = labels[l];
+        }
+
+        sym_index *refs[3];
+        int nr_refs = quad_operand_refs(quad, refs);
+        if (quad_result(quad) != NULL_SYM) {
+            refs[nr_refs++] = &quad->sym3;
+        }
+        for (int r = 0; r < nr_refs; r++) {
+            for (int l = 0; l < body->nr_locals; l++) {
+                if (body->locals[l] == *refs[r]) {
+                    *refs[r] = temps[l];
+                    break;
+                }
+            }
+        }
+
+        bool at_end = i + 2 == body->nr_quads;
+        if (quad->op_code == q_ireturn || quad->op_code == q_rreturn) {
+            if (result != NULL_SYM) {
+                q += new quadruple(quad->op_code == q_ireturn ?
+                                   q_iassign : q_rassign,
+                                   quad->sym2, NULL_SYM, result);
+            }
+            if (!at_end) {
+                q += new quadruple(q_jmp, labels[body->nr_labels - 1],
+                                   NULL_SYM, NULL_SYM);
+            }
+            delete quad;
+        } else if (quad->op_code == q_jmp && at_end &&
+                   body->quads[i]->int1 == body->last_label) {
+            delete quad;
+        } else {
+            q += quad;
+        }
+    }
+
+    delete[] temps;
+    delete[] labels;
+}
+
+
+
+/*** Tail calls. ***/
+
+/* Returns true if the call at quads[i] is in tail position. A function call
+   is if the next quad returns its result. A procedure call is if nothing but
+   labels and jumps lead from it to the end of the quad list. Each step
+   passes a quad, so a loop of jumps ends the search after nr_quads steps. */
+static bool is_tail_call(quadruple **quads, int nr_quads, int i,
+                         int last_label)
+{
+    quadruple *call = quads[i];
+    if (call->sym3 != NULL_SYM) {
+        return i + 1 < nr_quads &&
+               (quads[i + 1]->op_code == q_ireturn ||
+                quads[i + 1]->op_code == q_rreturn) &&
+               quads[i + 1]->sym2 == call->sym3;
+    }
+
+    int j = i + 1;
+    for (int steps = 0; steps < nr_quads && j < nr_quads; steps++) {
+        quadruple *q = quads[j];
+        if ((q->op_code == q_labl || q->op_code == q_jmp) &&
+            q->int1 == last_label) {
+            return true;
+        }
+        if (q->op_code == q_labl) {
+            j++;
+        } else if (q->op_code == q_jmp) {
+            j = 0;
+            while (j < nr_quads && (quads[j]->op_code != q_labl ||
+                                    quads[j]->int1 != q->int1)) {
+                j++;
+            }
+        } else {
+            return false;
+        }
+    }
+    return false;
+}
+
+
+/* Turn the calls a procedure or function makes to itself in tail position
+   into jumps back to its start. The parameter quads of such a call become
+   copies of the arguments to new temporaries, since an argument may read a
+   parameter assigned before it, and the call becomes copies of those to the
+   parameters and a jump to a label put first in the quad list. The label is
+   after the prologue, so the activation record is reused and the stack does
+   not grow. */
+quad_list *quad_optimizer::eliminate_tail_calls(quad_list *q)
+{
+    sym_index env = sym_tab->current_environment();
+    sym_type tag = sym_tab->get_symbol_tag(env);
+    if (tag != SYM_PROC && tag != SYM_FUNC) {
+        return q;
+    }
+    int nr_params = parameters_of(env);
+    if (nr_params < 0) {
+        return q;
+    }
+
+    // The quads are put in an array so the ones after a call can be seen.
+    int nr_quads = 0;
+    quad_list_iterator it(q);
+    for (quadruple *quad = it.get_current(); quad != NULL;
+         quad = it.get_next()) {
+        nr_quads++;
+    }
+    quadruple **quads = new quadruple*[nr_quads + 1];
+    nr_quads = 0;
+    bool found = false;
+    quad_list_iterator it2(q);
+    for (quadruple *quad = it2.get_current(); quad != NULL;
+         quad = it2.get_next()) {
+        quads[nr_quads++] = quad;
+    }
+    for (int i = 0; i < nr_quads; i++) {
+        if (quads[i]->op_code == q_call && quads[i]->sym1 == env &&
+            is_tail_call(quads, nr_quads, i, q->last_label)) {
+            found = true;
+        }
+    }
+    if (!found) {
+        delete[] quads;
+        return q;
+    }
+
+    int entry = sym_tab->get_next_label();
+    quad_list *result = new quad_list(q->last_label);
+    *result += new quadruple(q_labl, entry, NULL_SYM, NULL_SYM);
+
+    // The parameter quads not yet used by a call, see inline_calls().
+    quadruple **params = new quadruple*[nr_quads + 1];
+    int nr_pending = 0;
+    sym_index *temps = new sym_index[nr_params + 1];
+
+    for (int i = 0; i < nr_quads; i++) {
+        quadruple *quad = quads[i];
+        if (quad->op_code == q_param) {
+            params[nr_pending++] = quad;
+        }
+        if (quad->op_code != q_call) {
+            *result += quad;
+            continue;
+        }
+        if (quad->int2 > nr_pending) {
+            fatal("Internal compiler error: call without parameters");
+        }
+        nr_pending -= quad->int2;
+        if (quad->sym1 != env ||
+            !is_tail_call(quads, nr_quads, i, q->last_label)) {
+            *result += quad;
+            continue;
+        }
+
+        // The parameters were pushed last parameter first.
+        for (int k = 0; k < nr_params; k++) {
+            quadruple *param = params[nr_pending + nr_params - 1 - k];
+            sym_index type = sym_tab->get_symbol_type(env + 1 + k);
+            temps[k] = sym_tab->gen_temp_var(type);
+            param->op_code = type == real_type ? q_rassign : q_iassign;
+            param->sym3 = param->int3 = temps[k];
+        }
+        for (int k = 0; k < nr_params; k++) {
+            sym_index type = sym_tab->get_symbol_type(env + 1 + k);
+            *result += new quadruple(type == real_type ? q_rassign : q_iassign,
+                                     temps[k], NULL_SYM, env + 1 + k);
+        }
+        *result += new quadruple(q_jmp, entry, NULL_SYM, NULL_SYM);
+
+        // The return of a function call's result is never reached.
+        if (quad->sym3 != NULL_SYM) {
+            i++;
+        }
+    }
+
+    delete[] quads;
+    delete[] params;
+    delete[] temps;
+    return result;
+}
+
+
+
+/*** Local value numbering. ***/
+
+/* Allocate the tables for the graph. Each quad gives at most one new value
+   for its result and one for each operand read without a value. */
+void quad_optimizer::start_numbering()
+{
+    int nr_quads = 0;
+    int max_quads = 0;
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        nr_quads += cfg->blocks[b]->nr_quads;
+        if (cfg->blocks[b]->nr_quads > max_quads) {
+            max_quads = cfg->blocks[b]->nr_quads;
+        }
+    }
+
+    var_value = new int[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    var_stamp = new long[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        var_stamp[v] = 0;
+    }
+    stamp = 0;
+    block_stamp = 0;
+    call_stamp = 0;
+
+    values_size = nr_quads * 3;
+    value_holder = new sym_index[values_size];
+    nr_values = 0;
+
+    // At most half full.
+    value_table_size = 16;
+    while (value_table_size < max_quads * 2) {
+        value_table_size *= 2;
+    }
+    value_table = new value_entry[value_table_size];
+    for (int i = 0; i < value_table_size; i++) {
+        value_table[i].value = -1;
+    }
+    used_slots = new int[value_table_size];
+    nr_used = 0;
+    memory_version = 0;
+}
+
+
+void quad_optimizer::end_numbering()
+{
+    delete[] var_value;
+    delete[] var_stamp;
+    delete[] value_holder;
+    delete[] value_table;
+    delete[] used_slots;
+}
+
+
+/* Return a new value nr, held by the given variable. */
+int quad_optimizer::new_value(sym_index holder)
+{
+    if (nr_values == values_size) {
+        fatal("quad_optimizer::new_value(): too many values");
+    }
+    value_holder[nr_values] = holder;
+    return nr_values++;
+}
+
+
+/* Returns true if variable nr v has a value that isn't stale. */
+bool quad_optimizer::has_value(int v)
+{
+    long valid = cfg->named.test(v) ? call_stamp : block_stamp;
+    return var_stamp[v] >= valid;
+}
+
+
+/* The value of variable nr v, a new one if it has none. */
+int quad_optimizer::value_nr(int v)
+{
+    if (!has_value(v)) {
+        var_value[v] = new_value(cfg->vars[v]);
+        var_stamp[v] = stamp;
+    }
+    return var_value[v];
+}
+
+
+/* The value of an operand. Symbols that aren't variables, ie, constants,
+   never change, so they get a negative value made from the sym_index. */
+long quad_optimizer::value_of(sym_index sym_p)
+{
+    int v = cfg->var_nr(sym_p);
+    if (v < 0) {
+        return -sym_p - 2;
+    }
+    return value_nr(v);
+}
+
+
+/* Return the variable holding the same value as an operand, which is the
+   first one given the value in the block, if it still holds it. */
+sym_index quad_optimizer::holder_of(sym_index sym_p)
+{
+    int v = cfg->var_nr(sym_p);
+    if (v < 0) {
+        return sym_p;
+    }
+    int value = value_nr(v);
+    sym_index holder = value_holder[value];
+    int h = cfg->var_nr(holder);
+    if (has_value(h) && var_value[h] == value) {
+        return holder;
+    }
+    value_holder[value] = sym_p;
+    return sym_p;
+}
+
+
+/* Return the slot of the value table holding an expression, or the empty
+   slot where it should be entered. */
+value_entry *quad_optimizer::find_value(quad_op_type op, long a, long b,
+                                        long memory)
+{
+    unsigned long hash = ((unsigned long) op * 31 + a) * 2654435761UL
+                         + b * 40503UL + memory;
+    int i = hash & (value_table_size - 1);
+    while (value_table[i].value >= 0) {
+        value_entry *e = &value_table[i];
+        if (e->op == op && e->a == a && e->b == b && e->memory == memory) {
+            return e;
+        }
+        i = (i + 1) & (value_table_size - 1);
+    }
+    return &value_table[i];
+}
+
+
+/* Number the values computed in a basic block. Each operand is first
+   replaced by the variable holding its value. A pure quad computing a value
+   that is already held by a variable is then turned into a copy of that
+   variable, so later quads read it instead. The copies are left for dead
+   code elimination. */
+void quad_optimizer::number_values(basic_block *block)
+{
+    stamp++;
+    block_stamp = stamp;
+    call_stamp = stamp;
+    for (int i = 0; i < nr_used; i++) {
+        value_table[used_slots[i]].value = -1;
+    }
+    nr_used = 0;
+
+    for (int i = 0; i < block->nr_quads; i++) {
+        quadruple *q = block->quads[i];
+
+        sym_index *refs[2];
+        int nr_ops = quad_operand_refs(q, refs);
+        for (int o = 0; o < nr_ops; o++) {
+            *refs[o] = holder_of(*refs[o]);
+        }
+
+        if (q->op_code == q_call) {
+            stamp++;
+            call_stamp = stamp;
+            memory_version++;
+        } else if (q->op_code == q_rstore || q->op_code == q_istore) {
+            memory_version++;
+        }
+
+        sym_index result = quad_result(q);
+        int r = cfg->var_nr(result);
+        if (r < 0) {
+            continue;
+        }
+
+        if (!is_pure_quad(q)) {
+            int v = cfg->var_nr(q->sym1);
+            if ((q->op_code == q_iassign || q->op_code == q_rassign) &&
+                v >= 0) {
+                var_value[r] = value_nr(v);
+            } else {
+                var_value[r] = new_value(result);
+            }
+            var_stamp[r] = stamp;
+            continue;
+        }
+
+        long a;
+        long b;
+        long memory = 0;
+        switch (q->op_code) {
+        case q_rload:
+        case q_iload:
+            a = q->int1;
+            b = 0;
+            break;
+        case q_ishl:
+        case q_isar:
+        case q_iand_mask:
+            a = value_of(q->sym1);
+            b = q->int2;
+            break;
+        case q_inot:
+        case q_ruminus:
+        case q_iuminus:
+        case q_itor:
+            a = value_of(q->sym1);
+            b = 0;
+            break;
+        case q_rrindex:
+        case q_irindex:
+            memory = memory_version;
+            // Fall through.
+        case q_lindex:
+            // The array is the same symbol wherever it's indexed.
+            a = q->sym1;
+            b = value_of(q->sym2);
+            break;
+        default:
+            a = value_of(q->sym1);
+            b = value_of(q->sym2);
+            break;
+        }
+        if (is_commutative(q->op_code) && a > b) {
+            long t = a;
+            a = b;
+            b = t;
+        }
+
+        value_entry *e = find_value(q->op_code, a, b, memory);
+        if (e->value >= 0) {
+            sym_index holder = value_holder[e->value];
+            int h = cfg->var_nr(holder);
+            if (has_value(h) && var_value[h] == e->value) {
+                q->op_code = sym_tab->get_symbol_type(result) == real_type ?
+                             q_rassign : q_iassign;
+                q->sym1 = q->int1 = holder;
+                q->sym2 = q->int2 = NULL_SYM;
+            } else {
+                value_holder[e->value] = result;
+            }
+            var_value[r] = e->value;
+        } else {
+            e->op = q->op_code;
+            e->a = a;
+            e->b = b;
+            e->memory = memory;
+            e->value = new_value(result);
+            used_slots[nr_used++] = e - value_table;
+            var_value[r] = e->value;
+        }
+        var_stamp[r] = stamp;
+    }
+}
+
+
+
+/*** Copy propagation and dead code elimination. ***/
+
+/* Returns true for copies, ie, q_iassign and q_rassign. */
+static bool is_copy(quadruple *q)
+{
+    return q->op_code == q_iassign || q->op_code == q_rassign;
+}
+
+
+/* Count the quads writing and reading each variable. The tables are
+   reallocated, since the graph may have been rebuilt since last time. */
+void quad_optimizer::count_uses()
+{
+    delete[] def_count;
+    delete[] use_count;
+    def_count = new int[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    use_count = new int[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        def_count[v] = 0;
+        use_count[v] = 0;
+    }
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        for (int i = 0; i < block->nr_quads; i++) {
+            quadruple *q = block->quads[i];
+            int r = cfg->var_nr(quad_result(q));
+            if (r >= 0) {
+                def_count[r]++;
+            }
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            for (int o = 0; o < nr_ops; o++) {
+                int v = cfg->var_nr(ops[o]);
+                if (v >= 0) {
+                    use_count[v]++;
+                }
+            }
+        }
+    }
+}
+
+
+/* Propagate copies between temporaries. A temporary written only by a copy
+   of another temporary, which is itself written only once, holds the same
+   value wherever it is read, so all its reads can read the source instead.
+   The copy is then dead. Copies within a block have already been taken
+   care of by value numbering, so this is for reads in other blocks. */
+void quad_optimizer::propagate_copies()
+{
+    sym_index *source = new sym_index[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    bool found = false;
+
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        source[v] = NULL_SYM;
+    }
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        for (int i = 0; i < block->nr_quads; i++) {
+            quadruple *q = block->quads[i];
+            if (!is_copy(q)) {
+                continue;
+            }
+            int d = cfg->var_nr(q->sym3);
+            int s = cfg->var_nr(q->sym1);
+            if (d >= 0 && s >= 0 && d != s &&
+                !cfg->named.test(d) && !cfg->named.test(s) &&
+                def_count[d] == 1 && def_count[s] == 1) {
+                source[d] = q->sym1;
+                found = true;
+            }
+        }
+    }
+
+    if (found) {
+        for (int b = 0; b < cfg->nr_blocks; b++) {
+            basic_block *block = cfg->blocks[b];
+            for (int i = 0; i < block->nr_quads; i++) {
+                sym_index *refs[2];
+                int nr_ops = quad_operand_refs(block->quads[i], refs);
+                for (int o = 0; o < nr_ops; o++) {
+                    // Follow chains of copies, at most one step per copy.
+                    for (int n = 0; n < cfg->nr_vars; n++) {
+                        int v = cfg->var_nr(*refs[o]);
+                        if (v < 0 || source[v] == NULL_SYM) {
+                            break;
+                        }
+                        use_count[v]--;
+                        *refs[o] = source[v];
+                        use_count[cfg->var_nr(source[v])]++;
+                    }
+                }
+            }
+        }
+    }
+    delete[] source;
+}
+
+
+/* Coalesce copies x := t with the quad computing t, when t is a temporary
+   written once and only read in the same block. The quad writes x instead,
+   the copy goes away, and the other reads of t read x. This is only done
+   if x is neither read nor written between the quad and the copy, and x
+   keeps the value until the last read of t. A call may read or write the
+   named variables, so none may come in between either. */
+void quad_optimizer::coalesce_copies(basic_block *block)
+{
+    for (int j = 0; j < block->nr_quads; j++) {
+        quadruple *copy = block->quads[j];
+        if (!is_copy(copy)) {
+            continue;
+        }
+        sym_index x = copy->sym3;
+        sym_index t = copy->sym1;
+        int xv = cfg->var_nr(x);
+        int tv = cfg->var_nr(t);
+        if (xv < 0 || tv < 0 || xv == tv || cfg->named.test(tv) ||
+            def_count[tv] != 1) {
+            continue;
+        }
+
+        // Find the quad computing t.
+        int i;
+        for (i = j - 1; i >= 0; i--) {
+            quadruple *q = block->quads[i];
+            if (quad_result(q) == t) {
+                break;
+            }
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            bool conflict = q->op_code == q_call || quad_result(q) == x;
+            for (int o = 0; o < nr_ops; o++) {
+                if (ops[o] == x) {
+                    conflict = true;
+                }
+            }
+            if (conflict) {
+                i = -1;
+                break;
+            }
+        }
+        if (i < 0) {
+            continue;
+        }
+
+        // Make sure all the other reads of t come while x still holds it.
+        int remaining = use_count[tv] - 1;
+        bool x_valid = true;
+        for (int k = j + 1; k < block->nr_quads && remaining > 0; k++) {
+            quadruple *q = block->quads[k];
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            for (int o = 0; o < nr_ops; o++) {
+                if (ops[o] == t) {
+                    if (!x_valid) {
+                        remaining = -1;
+                    } else {
+                        remaining--;
+                    }
+                }
+            }
+            if (quad_result(q) == x ||
+                (q->op_code == q_call && cfg->named.test(xv))) {
+                x_valid = false;
+            }
+        }
+        if (remaining != 0) {
+            continue;
+        }
+
+        quadruple *def = block->quads[i];
+        def->sym3 = def->int3 = x;
+        copy->op_code = q_nop;
+        for (int k = j + 1; k < block->nr_quads; k++) {
+            sym_index *refs[2];
+            int nr_ops = quad_operand_refs(block->quads[k], refs);
+            for (int o = 0; o < nr_ops; o++) {
+                if (*refs[o] == t) {
+                    *refs[o] = x;
+                }
+            }
+        }
+        use_count[xv] += use_count[tv] - 1;
+        def_count[tv] = 0;
+        use_count[tv] = 0;
+        if (is_copy(def) && def->sym1 == x) {
+            def->op_code = q_nop;
+        }
+    }
+}
+
+
+/* Returns true if a quad can be removed when its result is never read. The
+   divisions are kept, since they trap when dividing by zero. */
+static bool is_removable(quadruple *q)
+{
+    if (q->op_code == q_idivide || q->op_code == q_imod) {
+        return false;
+    }
+    return is_copy(q) || is_pure_quad(q);
+}
+
+
+/* Replace quads whose results are dead with q_nop, as well as copies of a
+   variable to itself. Returns true if any quad was removed. */
+bool quad_optimizer::eliminate_dead_code()
+{
+    liveness *live = new liveness(cfg);
+    bit_vector now;
+    bool removed = false;
+
+    now.resize(cfg->nr_vars);
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        now.copy(live->out[b]);
+        for (int i = block->nr_quads - 1; i >= 0; i--) {
+            quadruple *q = block->quads[i];
+            if (q->op_code == q_nop) {
+                continue;
+            }
+            int r = cfg->var_nr(quad_result(q));
+            if ((r >= 0 && !now.test(r) && is_removable(q)) ||
+                (is_copy(q) && q->sym1 == q->sym3)) {
+                q->op_code = q_nop;
+                removed = true;
+                continue;
+            }
+            if (r >= 0) {
+                now.reset(r);
+            }
+            if (q->op_code == q_call) {
+                now.unite(cfg->named);
+            }
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            for (int o = 0; o < nr_ops; o++) {
+                int v = cfg->var_nr(ops[o]);
+                if (v >= 0) {
+                    now.set(v);
+                }
+            }
+        }
+    }
+    delete live;
+    return removed;
+}
+
+
+/* Drop the q_nop quads left by the passes above. The code generator doesn't
+   accept them. */
+void quad_optimizer::remove_nops()
+{
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        int n = 0;
+        for (int i = 0; i < block->nr_quads; i++) {
+            if (block->quads[i]->op_code != q_nop) {
+                block->quads[n++] = block->quads[i];
+            }
+        }
+        block->nr_quads = n;
+    }
+}
+
+
+/*** Loop invariant code motion. ***/
+
+/* Hoist the invariant quads out of the loops, one loop level per round. The
+   graph is rebuilt with the pre-headers after each round, so quads hoisted
+   out of an inner loop may be hoisted out of the loop around it in the next
+   round. Returns true if anything was hoisted. */
+bool quad_optimizer::hoist_invariants()
+{
+    bool moved = true;
+    bool hoisted = false;
+
+    while (moved) {
+        moved = false;
+        cfg->find_loops();
+        if (cfg->nr_loops == 0) {
+            break;
+        }
+
+        liveness *live = new liveness(cfg);
+        int *loop_defs = new int[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+        preheaders = new basic_block*[cfg->nr_blocks];
+        for (int b = 0; b < cfg->nr_blocks; b++) {
+            preheaders[b] = NULL;
+        }
+
+        for (int l = 0; l < cfg->nr_loops; l++) {
+            if (hoist_loop(cfg->loops[l], live, loop_defs)) {
+                moved = true;
+            }
+        }
+        if (moved) {
+            insert_preheaders();
+        }
+
+        for (int b = 0; b < cfg->nr_blocks; b++) {
+            delete preheaders[b];
+        }
+        delete[] preheaders;
+        preheaders = NULL;
+        delete[] loop_defs;
+        delete live;
+
+        if (moved) {
+            quad_list *q = cfg->to_quad_list();
+            delete cfg;
+            cfg = new control_flow_graph(q);
+            hoisted = true;
+        }
+    }
+    return hoisted;
+}
+
+
+/* Move the invariant quads of a loop to the pre-header of its header. A quad
+   is invariant if it is pure and its operands are constants, variables not
+   written in the loop, or results of invariant quads. Its result must be
+   written only by it in the loop and not be live at the header, so that
+   every read in the loop gets the hoisted value. The pre-header is run even
+   if the quad wasn't, so unless the quad's block dominates all exits from
+   the loop its result must be dead after the loop, and array reads must
+   stay. So must array reads in loops with bounds checks, which may be
+   guarding them. Division may trap and is never hoisted. loop_defs is work
+   space for counting the writes of each variable. Returns true if any quad
+   was moved. */
+bool quad_optimizer::hoist_loop(natural_loop *loop, liveness *live,
+                                int *loop_defs)
+{
+    int h = loop->header;
+
+    // The pre-header goes right before the header. If the block there is
+    // part of the loop and falls through to the header we leave it alone.
+    if (h > 0 && loop->body.test(h - 1)) {
+        basic_block *before = cfg->blocks[h - 1];
+        if (before->nr_succ > 0 && before->succ[0] == h &&
+            before->quads[before->nr_quads - 1]->op_code != q_jmp) {
+            return false;
+        }
+    }
+
+    // Count the writes in the loop, including quads already hoisted from
+    // loops inside it this round. They are still in the loop until the
+    // next round.
+    bool has_call = false;
+    bool has_store = false;
+    bool has_check = false;
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        loop_defs[v] = 0;
+    }
+    for (int i = 0; i < loop->nr_blocks; i++) {
+        int b = loop->blocks[i];
+        for (int pass = 0; pass < 2; pass++) {
+            basic_block *block = pass == 0 ? cfg->blocks[b] : preheaders[b];
+            if (block == NULL) {
+                continue;
+            }
+            for (int j = 0; j < block->nr_quads; j++) {
+                quadruple *q = block->quads[j];
+                if (q == NULL) {
+                    continue;
+                }
+                int r = cfg->var_nr(quad_result(q));
+                if (r >= 0) {
+                    loop_defs[r]++;
+                }
+                if (q->op_code == q_call) {
+                    has_call = true;
+                } else if (q->op_code == q_istore || q->op_code == q_rstore) {
+                    has_store = true;
+                } else if (q->op_code == q_bounds) {
+                    has_check = true;
+                }
+            }
+        }
+    }
+
+    bit_vector invariant;
+    bool moved = false;
+
+    invariant.resize(cfg->nr_vars);
+    for (int i = 0; i < loop->nr_blocks; i++) {
+        basic_block *block = cfg->blocks[loop->blocks[i]];
+
+        bool dominates_exits = true;
+        for (int e = 0; e < loop->nr_blocks && dominates_exits; e++) {
+            basic_block *exit = cfg->blocks[loop->blocks[e]];
+            for (int s = 0; s < exit->nr_succ; s++) {
+                if (!loop->body.test(exit->succ[s]) &&
+                    !cfg->dominates(block->nr, exit->nr)) {
+                    dominates_exits = false;
+                }
+            }
+        }
+
+        for (int j = 0; j < block->nr_quads; j++) {
+            quadruple *q = block->quads[j];
+            if (q == NULL || !is_pure_quad(q) ||
+                q->op_code == q_idivide || q->op_code == q_imod) {
+                continue;
+            }
+            bool reads_memory =
+                q->op_code == q_irindex || q->op_code == q_rrindex;
+            if (reads_memory &&
+                (has_store || has_call || has_check || !dominates_exits)) {
+                continue;
+            }
+
+            int r = cfg->var_nr(quad_result(q));
+            if (r < 0 || loop_defs[r] != 1 || live->in[h].test(r) ||
+                (has_call && cfg->named.test(r))) {
+                continue;
+            }
+            if (!dominates_exits) {
+                bool live_after = false;
+                for (int e = 0; e < loop->nr_blocks; e++) {
+                    basic_block *exit = cfg->blocks[loop->blocks[e]];
+                    for (int s = 0; s < exit->nr_succ; s++) {
+                        int succ = exit->succ[s];
+                        if (!loop->body.test(succ) && live->in[succ].test(r)) {
+                            live_after = true;
+                        }
+                    }
+                }
+                if (live_after) {
+                    continue;
+                }
+            }
+
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            bool operands_invariant = true;
+            for (int o = 0; o < nr_ops; o++) {
+                int v = cfg->var_nr(ops[o]);
+                if (v >= 0 && !invariant.test(v) &&
+                    (loop_defs[v] > 0 || (has_call && cfg->named.test(v)))) {
+                    operands_invariant = false;
+                }
+            }
+            if (!operands_invariant) {
+                continue;
+            }
+
+            if (preheaders[h] == NULL) {
+                preheaders[h] = new basic_block(h);
+            }
+            preheaders[h]->append_quad(q);
+            block->quads[j] = NULL;
+            invariant.set(r);
+            moved = true;
+        }
+    }
+
+    if (moved) {
+        // Remember which blocks are outside the loop, see
+        // insert_preheaders().
+        preheaders[h]->nr_preds = 0;
+        for (int p = 0; p < cfg->blocks[h]->nr_preds; p++) {
+            int pred = cfg->blocks[h]->preds[p];
+            if (!loop->body.test(pred)) {
+                preheaders[h]->add_pred(pred);
+            }
+        }
+    }
+    return moved;
+}
+
+
+/* Put the pre-headers in front of their headers. The blocks entering a loop
+   by jumping to its header jump to the pre-header instead, which then needs
+   a label of its own. The back edges keep jumping to the header. */
+void quad_optimizer::insert_preheaders()
+{
+    for (int h = 0; h < cfg->nr_blocks; h++) {
+        basic_block *preheader = preheaders[h];
+        if (preheader == NULL) {
+            continue;
+        }
+        long header_label = cfg->blocks[h]->quads[0]->int1;
+        long label = -1;
+        for (int p = 0; p < preheader->nr_preds; p++) {
+            // Jumps are never hoisted, so a hole at the end means there is
+            // no jump.
+            basic_block *pred = cfg->blocks[preheader->preds[p]];
+            quadruple *last = pred->quads[pred->nr_quads - 1];
+            if (last != NULL &&
+                (last->op_code == q_jmp || last->op_code == q_jmpf) &&
+                last->int1 == header_label) {
+                if (label < 0) {
+                    label = sym_tab->get_next_label();
+                }
+                last->int1 = last->sym1 = label;
+            }
+        }
+
+        // Rebuild the header block with the pre-header in front of it.
+        basic_block *header = cfg->blocks[h];
+        basic_block *merged = new basic_block(h);
+        if (label >= 0) {
+            merged->append_quad(new quadruple(q_labl, label, NULL_SYM,
+                                              NULL_SYM));
+        }
+        for (int i = 0; i < preheader->nr_quads; i++) {
+            merged->append_quad(preheader->quads[i]);
+        }
+        for (int i = 0; i < header->nr_quads; i++) {
+            merged->append_quad(header->quads[i]);
+        }
+        cfg->blocks[h] = merged;
+        delete header;
+    }
+
+    // Drop the holes left by the hoisted quads.
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        int n = 0;
+        for (int i = 0; i < block->nr_quads; i++) {
+            if (block->quads[i] != NULL) {
+                block->quads[n++] = block->quads[i];
+            }
+        }
+        block->nr_quads = n;
+    }
+}
+
+
+/*** Loop unrolling. ***/
+
+/* Unroll the innermost counted loops, see unroll_loop(). The unrolled
+   copies are put in front of the loops the same way as pre-headers, and the
+   graph is rebuilt. Returns true if any loop was unrolled. */
+bool quad_optimizer::unroll_loops()
+{
+    cfg->find_loops();
+    if (cfg->nr_loops == 0) {
+        return false;
+    }
+
+    liveness *live = new liveness(cfg);
+    int *loop_defs = new int[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    preheaders = new basic_block*[cfg->nr_blocks];
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        preheaders[b] = NULL;
+    }
+
+    bool unrolled = false;
+    for (int l = 0; l < cfg->nr_loops; l++) {
+        bool innermost = true;
+        for (int m = 0; m < cfg->nr_loops; m++) {
+            if (m != l && cfg->loops[l]->body.test(cfg->loops[m]->header)) {
+                innermost = false;
+            }
+        }
+        if (innermost && unroll_loop(cfg->loops[l], live, loop_defs)) {
+            unrolled = true;
+        }
+    }
+    if (unrolled) {
+        insert_preheaders();
+    }
+
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        delete preheaders[b];
+    }
+    delete[] preheaders;
+    preheaders = NULL;
+    delete[] loop_defs;
+    delete live;
+
+    if (unrolled) {
+        quad_list *q = cfg->to_quad_list();
+        delete cfg;
+        cfg = new control_flow_graph(q);
+    }
+    return unrolled;
+}
+
+
+/* Unroll a loop of the form
+
+       H:  t := i < m            (or i > m, m > i, m < i, possibly negated)
+           jmpf X t
+           body, writing i once with i := i + c
+           jmp H
+
+   where the body always falls through to the next block or jumps within
+   itself, m and c are not written in the loop and the body's writing of i
+   is run in every iteration. If the test holds for i + (f - 1) * c it holds
+   for the f - 1 values of i before it, as long as c goes the same way as
+   the test. So f copies of the body are run after a single test of that,
+   and the original loop, entered when the test fails, runs the remaining
+   iterations. The code goes in front of the header:
+
+           u := (f - 1) * c
+           l := LONG_MAX - u + 1      (LONG_MIN - u - 1 for a negative c)
+       U:  jmpf H i < l               (i > l for a negative c)
+           t' := i + u < m
+           jmpf H t'
+           f copies of the body
+           jmp U
+
+   The temporaries the body writes that are not live at the header only
+   carry values within an iteration, and get new names in each copy, as do
+   the labels. loop_defs is work space, see hoist_loop(). */
+bool quad_optimizer::unroll_loop(natural_loop *loop, liveness *live,
+                                 int *loop_defs)
+{
+    int h = loop->header;
+    int latch = h + loop->nr_blocks - 1;
+    basic_block *header = cfg->blocks[h];
+
+    // The loop must be the blocks from the header to the back edge, with
+    // the test alone in the header.
+    if (latch == h || latch >= cfg->nr_blocks) {
+        return false;
+    }
+    for (int b = h; b <= latch; b++) {
+        if (!loop->body.test(b)) {
+            return false;
+        }
+    }
+    if (header->nr_quads < 3 || header->nr_quads > 4 ||
+        header->quads[0]->op_code != q_labl) {
+        return false;
+    }
+    long header_label = header->quads[0]->int1;
+    quadruple *test = header->quads[1];
+    quadruple *branch = header->quads[header->nr_quads - 1];
+    bool negated = header->nr_quads == 4;
+    sym_index cond = test->sym3;
+    if (negated) {
+        quadruple *neg = header->quads[2];
+        if (neg->op_code != q_inot || neg->sym1 != cond) {
+            return false;
+        }
+        cond = neg->sym3;
+    }
+    if ((test->op_code != q_ilt && test->op_code != q_igt) ||
+        branch->op_code != q_jmpf || branch->sym2 != cond ||
+        header->nr_succ != 2 || loop->body.test(header->succ[1])) {
+        return false;
+    }
+
+    // The only way out is the test, and the only way back is the last jump.
+    basic_block *back = cfg->blocks[latch];
+    if (back->nr_quads == 0) {
+        return false;
+    }
+    quadruple *back_jump = back->quads[back->nr_quads - 1];
+    if (back_jump->op_code != q_jmp || back_jump->int1 != header_label) {
+        return false;
+    }
+    int size = 0;
+    bool has_call = false;
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        loop_defs[v] = 0;
+    }
+    for (int b = h + 1; b <= latch; b++) {
+        basic_block *block = cfg->blocks[b];
+        for (int s = 0; s < block->nr_succ; s++) {
+            if (!loop->body.test(block->succ[s]) ||
+                (block->succ[s] == h && b != latch)) {
+                return false;
+            }
+        }
+        for (int j = 0; j < block->nr_quads; j++) {
+            quadruple *q = block->quads[j];
+            int r = cfg->var_nr(quad_result(q));
+            if (r >= 0) {
+                loop_defs[r]++;
+            }
+            if (q->op_code == q_call) {
+                has_call = true;
+            }
+
+            // The results of the test are not kept for the body.
+            sym_index ops[2];
+            int nr_ops = quad_operands(q, ops);
+            for (int o = 0; o < nr_ops; o++) {
+                if (ops[o] == test->sym3 || ops[o] == cond) {
+                    return false;
+                }
+            }
+        }
+        size += block->nr_quads;
+    }
+    if (size == 0 || unroll_factor > MAX_UNROLL_SIZE / size) {
+        return false;
+    }
+
+    // One side of the test is the induction variable, the other one is
+    // not written in the loop.
+    int a = cfg->var_nr(test->sym1);
+    int b = cfg->var_nr(test->sym2);
+    int a_defs = a >= 0 ? loop_defs[a] : 0;
+    int b_defs = b >= 0 ? loop_defs[b] : 0;
+    if (a_defs + b_defs != 1) {
+        return false;
+    }
+    bool i_first = a_defs == 1;
+    sym_index i_sym = i_first ? test->sym1 : test->sym2;
+    int m = i_first ? b : a;
+    if (has_call && (cfg->named.test(i_first ? a : b) ||
+                     (m >= 0 && cfg->named.test(m)))) {
+        return false;
+    }
+
+    // Find the step, which must be a constant loaded once.
+    quadruple *step_quad = NULL;
+    int step_block = -1;
+    for (int bl = h + 1; bl <= latch; bl++) {
+        basic_block *block = cfg->blocks[bl];
+        for (int j = 0; j < block->nr_quads; j++) {
+            if (quad_result(block->quads[j]) == i_sym) {
+                step_quad = block->quads[j];
+                step_block = bl;
+            }
+        }
+    }
+    sym_index c_sym;
+    if (step_quad->op_code == q_iplus && step_quad->sym1 == i_sym) {
+        c_sym = step_quad->sym2;
+    } else if (step_quad->op_code == q_iplus && step_quad->sym2 == i_sym) {
+        c_sym = step_quad->sym1;
+    } else if (step_quad->op_code == q_iminus && step_quad->sym1 == i_sym) {
+        c_sym = step_quad->sym2;
+    } else {
+        return false;
+    }
+    if (!cfg->dominates(step_block, latch)) {
+        return false;
+    }
+    quadruple *c_def = NULL;
+    int nr_c_defs = 0;
+    for (int bl = 0; bl < cfg->nr_blocks; bl++) {
+        basic_block *block = cfg->blocks[bl];
+        for (int j = 0; j < block->nr_quads; j++) {
+            if (quad_result(block->quads[j]) == c_sym) {
+                c_def = block->quads[j];
+                nr_c_defs++;
+            }
+        }
+    }
+    int c = cfg->var_nr(c_sym);
+    if (nr_c_defs != 1 || c_def->op_code != q_iload || c < 0 ||
+        loop_defs[c] > 0) {
+        return false;
+    }
+    long step = step_quad->op_code == q_iplus ? c_def->int1 : -c_def->int1;
+
+    // i < m and m > i need a growing i.
+    int direction = (test->op_code == q_ilt) == i_first ? 1 : -1;
+    if (negated) {
+        direction = -direction;
+    }
+    if (step == 0 || (step > 0) != (direction > 0)) {
+        return false;
+    }
+    // The span of the unrolled iterations must fit in a long.
+    long max_step = LONG_MAX / unroll_factor;
+    if (step > max_step || step < -max_step) {
+        return false;
+    }
+
+    // The test of the last of the unrolled iterations. i + span mustn't
+    // overflow, so i is first compared to the limit where it would, and
+    // the loop is left to the original one from there.
+    basic_block *unrolled = new basic_block(h);
+    long span_value = (unroll_factor - 1) * step;
+    sym_index span = sym_tab->gen_temp_var(integer_type);
+    sym_index limit = sym_tab->gen_temp_var(integer_type);
+    sym_index last_i = sym_tab->gen_temp_var(integer_type);
+    sym_index in_range = sym_tab->gen_temp_var(integer_type);
+    int top = sym_tab->get_next_label();
+    unrolled->append_quad(new quadruple(q_iload, span_value, NULL_SYM, span));
+    unrolled->append_quad(new quadruple(q_iload,
+                                        step > 0 ? LONG_MAX - span_value + 1
+                                                 : LONG_MIN - span_value - 1,
+                                        NULL_SYM, limit));
+    unrolled->append_quad(new quadruple(q_labl, top, NULL_SYM, NULL_SYM));
+    unrolled->append_quad(new quadruple(step > 0 ? q_ilt : q_igt, i_sym,
+                                        limit, in_range));
+    unrolled->append_quad(new quadruple(q_jmpf, header_label, in_range,
+                                        NULL_SYM));
+    unrolled->append_quad(new quadruple(q_iplus, i_sym, span, last_i));
+    sym_index t = sym_tab->gen_temp_var(integer_type);
+    unrolled->append_quad(new quadruple(test->op_code,
+                                        i_first ? last_i : test->sym1,
+                                        i_first ? test->sym2 : last_i, t));
+    if (negated) {
+        sym_index not_t = sym_tab->gen_temp_var(integer_type);
+        unrolled->append_quad(new quadruple(q_inot, t, NULL_SYM, not_t));
+        t = not_t;
+    }
+    unrolled->append_quad(new quadruple(q_jmpf, header_label, t, NULL_SYM));
+
+    // The copies. Labels are renamed through a table of the body's labels.
+    sym_index *names = new sym_index[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    int *labels = new int[size];
+    int *new_labels = new int[size];
+    int nr_labels = 0;
+    for (int bl = h + 1; bl <= latch; bl++) {
+        basic_block *block = cfg->blocks[bl];
+        if (block->nr_quads > 0 && block->quads[0]->op_code == q_labl) {
+            labels[nr_labels++] = block->quads[0]->int1;
+        }
+    }
+
+    for (int k = 0; k < unroll_factor; k++) {
+        for (int v = 0; v < cfg->nr_vars; v++) {
+            names[v] = cfg->vars[v];
+            if (loop_defs[v] > 0 && !cfg->named.test(v) &&
+                !cfg->nonlocal.test(v) && !live->in[h].test(v)) {
+                names[v] = sym_tab->gen_temp_var(
+                    sym_tab->get_symbol_type(cfg->vars[v]));
+            }
+        }
+        for (int l = 0; l < nr_labels; l++) {
+            new_labels[l] = sym_tab->get_next_label();
+        }
+
+        for (int bl = h + 1; bl <= latch; bl++) {
+            basic_block *block = cfg->blocks[bl];
+            for (int j = 0; j < block->nr_quads; j++) {
+                quadruple *q = block->quads[j];
+                if (q == back_jump) {
+                    // The copies run into each other, the last one back
+                    // to the test.
+                    if (k == unroll_factor - 1) {
+                        unrolled->append_quad(new quadruple(q_jmp, top,
+                                                            NULL_SYM,
+                                                            NULL_SYM));
+                    }
+                    continue;
+                }
+
+                quadruple *copy = new quadruple(*q);
+                if (q->op_code == q_labl || q->op_code == q_jmp ||
+                    q->op_code == q_jmpf) {
+                    for (int l = 0; l < nr_labels; l++) {
+                        if (labels[l] == q->int1) {
+                            copy->int1 = copy->sym1 = new_labels[l];
+                        }
+                    }
+                }
+                sym_index *refs[3];
+                int nr_refs = quad_operand_refs(copy, refs);
+                if (quad_result(copy) != NULL_SYM) {
+                    refs[nr_refs++] = &copy->sym3;
+                }
+                for (int r = 0; r < nr_refs; r++) {
+                    int v = cfg->var_nr(*refs[r]);
+                    if (v >= 0) {
+                        *refs[r] = names[v];
+                    }
+                }
+                unrolled->append_quad(copy);
+            }
+        }
+    }
+    delete[] names;
+    delete[] labels;
+    delete[] new_labels;
+
+    // Remember which blocks are outside the loop, see insert_preheaders().
+    for (int p = 0; p < header->nr_preds; p++) {
+        if (!loop->body.test(header->preds[p])) {
+            unrolled->add_pred(header->preds[p]);
+        }
+    }
+    preheaders[h] = unrolled;
+    return true;
+}
+
+
+
+/*** Bounds check elimination. ***/
+
+// Ranges with bounds this far from 0 are not multiplied, so the products
+// fit in a long.
+const long RANGE_LIMIT = 1L << 31;
+
+// The ranges of a loop header are widened after this many changes, see
+// join_ranges().
+const int WIDEN_AFTER = 3;
+
+
+static const value_range no_range = { LONG_MIN, LONG_MAX };
+
+
+/* a + b for a lower (upper is false) or upper bound. An unbounded operand
+   or a sum out of range gives no bound. */
+static long add_bounds(long a, long b, bool upper)
+{
+    long none = upper ? LONG_MAX : LONG_MIN;
+    if (a == LONG_MIN || a == LONG_MAX || b == LONG_MIN || b == LONG_MAX ||
+        (b > 0 && a > LONG_MAX - b) || (b < 0 && a < LONG_MIN - b)) {
+        return none;
+    }
+    return a + b;
+}
+
+
+/* Returns true if both bounds of a range are small enough to multiply. */
+static bool is_small(value_range r)
+{
+    return r.lo > -RANGE_LIMIT && r.hi < RANGE_LIMIT;
+}
+
+
+/* The range of a * b for small ranges, which is spanned by the products
+   of their bounds. */
+static value_range multiply_ranges(value_range a, value_range b)
+{
+    if (!is_small(a) || !is_small(b)) {
+        return no_range;
+    }
+    long p[4] = { a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+    value_range r = { p[0], p[0] };
+    for (int i = 1; i < 4; i++) {
+        if (p[i] < r.lo) {
+            r.lo = p[i];
+        }
+        if (p[i] > r.hi) {
+            r.hi = p[i];
+        }
+    }
+    return r;
+}
+
+
+/* Find the variables whose ranges are needed, ie, the indices of the bounds
+   checks, the operands of the quads writing a needed variable, and the
+   operands of the integer comparisons. A comparison may narrow a needed
+   variable through the one it's computed from, as in i + 1 < n, so all of
+   them count. Only integer variables are kept track of. Since each pass
+   over the quads adds the operands of the variables found in the last one,
+   the passes are repeated until nothing is added. */
+void quad_optimizer::find_tracked()
+{
+    tracked = new int[cfg->nr_vars > 0 ? cfg->nr_vars : 1];
+    nr_tracked = 0;
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        tracked[v] = -1;
+    }
+
+    bool added = true;
+    while (added) {
+        added = false;
+        for (int b = 0; b < cfg->nr_blocks; b++) {
+            basic_block *block = cfg->blocks[b];
+            for (int i = 0; i < block->nr_quads; i++) {
+                quadruple *q = block->quads[i];
+                sym_index ops[2];
+                int nr_ops = quad_operands(q, ops);
+                int r = cfg->var_nr(quad_result(q));
+
+                bool needed;
+                if (q->op_code == q_bounds) {
+                    needed = true;
+                } else if (q->op_code == q_ilt || q->op_code == q_igt ||
+                           q->op_code == q_ieq) {
+                    needed = true;
+                } else {
+                    needed = is_pure_quad(q) && r >= 0 && tracked[r] >= 0;
+                    needed = needed || (q->op_code == q_iassign &&
+                                        r >= 0 && tracked[r] >= 0);
+                }
+                if (!needed) {
+                    continue;
+                }
+                for (int o = 0; o < nr_ops; o++) {
+                    int v = cfg->var_nr(ops[o]);
+                    if (v >= 0 && tracked[v] < 0 &&
+                        sym_tab->get_symbol_type(ops[o]) == integer_type) {
+                        tracked[v] = nr_tracked++;
+                        added = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/* The range of a symbol in the given ranges. */
+value_range quad_optimizer::range_of(value_range *ranges, sym_index sym)
+{
+    int v = cfg->var_nr(sym);
+    if (v >= 0 && tracked[v] >= 0) {
+        return ranges[tracked[v]];
+    }
+    return no_range;
+}
+
+
+/* Apply the effect of a quad to the ranges of the tracked variables. A
+   call may write the named variables its callee can see, ie, the ones
+   declared at its own level or further out. A bounds check that passed
+   leaves the index in range. */
+void quad_optimizer::transfer_ranges(quadruple *q, value_range *ranges)
+{
+    if (q->op_code == q_call) {
+        block_level level = sym_tab->get_symbol_level(q->sym1);
+        for (int v = 0; v < cfg->nr_vars; v++) {
+            if (tracked[v] >= 0 && cfg->named.test(v) &&
+                sym_tab->get_symbol_level(cfg->vars[v]) <= level) {
+                ranges[tracked[v]] = no_range;
+            }
+        }
+    }
+    if (q->op_code == q_bounds) {
+        int v = cfg->var_nr(q->sym1);
+        if (v >= 0 && tracked[v] >= 0) {
+            value_range &r = ranges[tracked[v]];
+            if (r.lo < 0) {
+                r.lo = 0;
+            }
+            if (r.hi > q->int2 - 1) {
+                r.hi = q->int2 - 1;
+            }
+        }
+        return;
+    }
+
+    int v = cfg->var_nr(quad_result(q));
+    if (v < 0 || tracked[v] < 0) {
+        return;
+    }
+    value_range a = range_of(ranges, q->sym1);
+    value_range b = range_of(ranges, q->sym2);
+    value_range r = no_range;
+
+    switch (q->op_code) {
+    case q_iload:
+        r.lo = r.hi = q->int1;
+        break;
+    case q_iassign:
+        r = a;
+        break;
+    case q_iplus:
+        r.lo = add_bounds(a.lo, b.lo, false);
+        r.hi = add_bounds(a.hi, b.hi, true);
+        break;
+    case q_iminus:
+        if (b.hi != LONG_MIN && b.hi != LONG_MAX) {
+            r.lo = add_bounds(a.lo, -b.hi, false);
+        }
+        if (b.lo != LONG_MIN && b.lo != LONG_MAX) {
+            r.hi = add_bounds(a.hi, -b.lo, true);
+        }
+        break;
+    case q_iuminus:
+        if (is_small(a)) {
+            r.lo = -a.hi;
+            r.hi = -a.lo;
+        }
+        break;
+    case q_imult:
+        r = multiply_ranges(a, b);
+        break;
+    case q_ishl:
+        if (q->int2 >= 0 && q->int2 < 31) {
+            value_range factor = { 1L << q->int2, 1L << q->int2 };
+            r = multiply_ranges(a, factor);
+        }
+        break;
+    case q_isar:
+        if (is_small(a) && q->int2 >= 0 && q->int2 < 63) {
+            r.lo = a.lo >> q->int2;
+            r.hi = a.hi >> q->int2;
+        }
+        break;
+    case q_iand_mask:
+        if (q->int2 >= 0) {
+            r.lo = 0;
+            r.hi = q->int2;
+        }
+        break;
+    case q_imod:
+        // The remainder has the sign of the dividend.
+        if (b.lo > 0 && b.hi != LONG_MAX) {
+            r.lo = a.lo >= 0 ? 0 : -(b.hi - 1);
+            r.hi = b.hi - 1;
+            if (a.lo >= 0 && a.hi < r.hi) {
+                r.hi = a.hi;
+            }
+        }
+        break;
+    case q_idivide:
+        // Division by a positive number is monotone in both operands.
+        if (b.lo > 0 && is_small(a) && is_small(b)) {
+            long p[4] = { a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi };
+            r.lo = r.hi = p[0];
+            for (int i = 1; i < 4; i++) {
+                if (p[i] < r.lo) {
+                    r.lo = p[i];
+                }
+                if (p[i] > r.hi) {
+                    r.hi = p[i];
+                }
+            }
+        }
+        break;
+    case q_inot:
+    case q_ior:
+    case q_iand:
+    case q_req:
+    case q_ieq:
+    case q_rne:
+    case q_ine:
+    case q_rlt:
+    case q_ilt:
+    case q_rgt:
+    case q_igt:
+        r.lo = 0;
+        r.hi = 1;
+        break;
+    default:
+        break;
+    }
+    ranges[tracked[v]] = r;
+}
+
+
+/* If sym is written by quad nr i of a block as w + k or w - k, where k is a
+   constant, and neither w nor k is written after that in the block, then
+   w is sym - k or sym + k at the end of the block. Narrow the range of w
+   by the range r of sym accordingly. Returns false if the ranges show that
+   this can't happen. */
+bool quad_optimizer::narrow_operand(basic_block *block, int i, sym_index sym,
+                                    value_range r, value_range *ranges)
+{
+    while (i >= 0 && quad_result(block->quads[i]) != sym) {
+        i--;
+    }
+    if (i < 0) {
+        return true;
+    }
+    quadruple *def = block->quads[i];
+    if (def->op_code != q_iplus && def->op_code != q_iminus) {
+        return true;
+    }
+    sym_index w = def->sym1;
+    sym_index k = def->sym2;
+    value_range rk = range_of(ranges, k);
+    if (def->op_code == q_iplus && rk.lo != rk.hi) {
+        w = def->sym2;
+        k = def->sym1;
+        rk = range_of(ranges, k);
+    }
+    int vw = cfg->var_nr(w);
+    if (rk.lo != rk.hi || rk.lo == LONG_MIN || rk.lo == LONG_MAX ||
+        vw < 0 || tracked[vw] < 0 || w == sym) {
+        return true;
+    }
+    for (int j = i + 1; j < block->nr_quads; j++) {
+        sym_index written = quad_result(block->quads[j]);
+        if (written == w || written == k ||
+            block->quads[j]->op_code == q_call) {
+            return true;
+        }
+    }
+
+    long offset = def->op_code == q_iplus ? -rk.lo : rk.lo;
+    value_range &rw = ranges[tracked[vw]];
+    long lo = add_bounds(r.lo, offset, false);
+    long hi = add_bounds(r.hi, offset, true);
+    if (lo > rw.lo) {
+        rw.lo = lo;
+    }
+    if (hi < rw.hi) {
+        rw.hi = hi;
+    }
+    return rw.lo <= rw.hi;
+}
+
+
+/* Narrow the ranges at the end of a block for the edge to its successor
+   nr s, given by the comparison a conditional jump at the end depends on.
+   The fall-through edge is taken if the comparison holds. Returns false if
+   the ranges show that the edge is never taken. */
+bool quad_optimizer::refine_ranges(basic_block *block, int s,
+                                   value_range *ranges)
+{
+    quadruple *branch = block->quads[block->nr_quads - 1];
+    if (branch->op_code != q_jmpf || block->nr_succ != 2) {
+        return true;
+    }
+
+    // Find the comparison, through a negation.
+    bool holds = s == 0;
+    sym_index cond = branch->sym2;
+    int i = block->nr_quads - 2;
+    while (i >= 0 && quad_result(block->quads[i]) != cond) {
+        i--;
+    }
+    if (i >= 0 && block->quads[i]->op_code == q_inot) {
+        holds = !holds;
+        cond = block->quads[i]->sym1;
+        while (i >= 0 && quad_result(block->quads[i]) != cond) {
+            i--;
+        }
+    }
+    if (i < 0) {
+        return true;
+    }
+    quadruple *test = block->quads[i];
+    if (test->op_code != q_ilt && test->op_code != q_igt &&
+        test->op_code != q_ieq) {
+        return true;
+    }
+    for (int j = i + 1; j < block->nr_quads; j++) {
+        sym_index r = quad_result(block->quads[j]);
+        if (r == test->sym1 || r == test->sym2 ||
+            block->quads[j]->op_code == q_call) {
+            return true;
+        }
+    }
+
+    // Turn x > y into y < x.
+    sym_index x = test->sym1;
+    sym_index y = test->sym2;
+    if (test->op_code == q_igt) {
+        x = test->sym2;
+        y = test->sym1;
+    }
+    value_range rx = range_of(ranges, x);
+    value_range ry = range_of(ranges, y);
+
+    if (test->op_code == q_ieq) {
+        if (!holds) {
+            return true;
+        }
+        if (ry.lo > rx.lo) {
+            rx.lo = ry.lo;
+        }
+        if (ry.hi < rx.hi) {
+            rx.hi = ry.hi;
+        }
+        ry = rx;
+    } else if (holds) {
+        // x < y, so x <= y.hi - 1 and y >= x.lo + 1.
+        long hi = add_bounds(ry.hi, -1, true);
+        long lo = add_bounds(rx.lo, 1, false);
+        if (hi < rx.hi) {
+            rx.hi = hi;
+        }
+        if (lo > ry.lo) {
+            ry.lo = lo;
+        }
+    } else {
+        // x >= y, so x >= y.lo and y <= x.hi.
+        if (ry.lo > rx.lo) {
+            rx.lo = ry.lo;
+        }
+        if (rx.hi < ry.hi) {
+            ry.hi = rx.hi;
+        }
+    }
+    if (rx.lo > rx.hi || ry.lo > ry.hi) {
+        return false;
+    }
+
+    int vx = cfg->var_nr(x);
+    int vy = cfg->var_nr(y);
+    if (vx >= 0 && tracked[vx] >= 0) {
+        ranges[tracked[vx]] = rx;
+    }
+    if (vy >= 0 && tracked[vy] >= 0) {
+        ranges[tracked[vy]] = ry;
+    }
+
+    // The sides may have just been computed from other variables, as in
+    // i + 1 < n or the test in front of an unrolled loop.
+    return narrow_operand(block, i - 1, x, rx, ranges) &&
+           narrow_operand(block, i - 1, y, ry, ranges);
+}
+
+
+/* Join ranges flowing along an edge into the ranges at the start of a
+   block. A loop header whose ranges keep changing along its back edges
+   probably has a variable growing each time around the loop, so after a
+   few such changes the bounds that still move are dropped. Returns true if
+   the ranges changed. */
+static bool join_ranges(value_range *to, value_range *from, int nr,
+                        bool *reached, int *changes, bool back_edge)
+{
+    if (!*reached) {
+        memcpy(to, from, nr * sizeof(value_range));
+        *reached = true;
+        return true;
+    }
+
+    bool changed = false;
+    bool widen = back_edge && *changes >= WIDEN_AFTER;
+    for (int t = 0; t < nr; t++) {
+        if (from[t].lo < to[t].lo) {
+            to[t].lo = widen ? LONG_MIN : from[t].lo;
+            changed = true;
+        }
+        if (from[t].hi > to[t].hi) {
+            to[t].hi = widen ? LONG_MAX : from[t].hi;
+            changed = true;
+        }
+    }
+    if (changed && back_edge) {
+        (*changes)++;
+    }
+    return changed;
+}
+
+
+/* Returns true if block nr b is part of a loop. The loops must have been
+   found. */
+bool quad_optimizer::is_in_loop(int b)
+{
+    for (int l = 0; l < cfg->nr_loops; l++) {
+        if (cfg->loops[l]->body.test(b)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/* Count the bounds checks of a quad list that isn't optimized, for the
+   report in parser.y. All of them are left. */
+void quad_optimizer::count_bounds_checks(quad_list *q)
+{
+    cfg = new control_flow_graph(q);
+    cfg->find_loops();
+    nr_checks = 0;
+    nr_checks_in_loops = 0;
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        for (int i = 0; i < block->nr_quads; i++) {
+            if (block->quads[i]->op_code == q_bounds) {
+                nr_checks++;
+                if (is_in_loop(b)) {
+                    nr_checks_in_loops++;
+                }
+            }
+        }
+    }
+    nr_checks_left = nr_checks;
+    delete cfg;
+    cfg = NULL;
+}
+
+
+/* Remove the bounds checks of indices known to be in range. The range of
+   each integer variable that matters is found with a forward analysis
+   over the graph. It starts out unbounded at the entry, is computed
+   through the quads of each block, and is narrowed along the edges of
+   conditional jumps on comparisons. The ranges flowing into a block from
+   its predecessors are joined, ie, their bounds are the widest ones. A check
+   of an index whose range is within the array is turned into a q_nop. The
+   nr of checks before and after is kept for the report in parser.y. */
+void quad_optimizer::remove_bounds_checks()
+{
+    nr_checks = 0;
+    nr_checks_left = 0;
+    nr_checks_in_loops = 0;
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        for (int i = 0; i < block->nr_quads; i++) {
+            if (block->quads[i]->op_code == q_bounds) {
+                nr_checks++;
+            }
+        }
+    }
+    if (nr_checks == 0) {
+        return;
+    }
+
+    find_tracked();
+    int nr = nr_tracked > 0 ? nr_tracked : 1;
+    value_range *in = new value_range[cfg->nr_blocks * nr];
+    bool *reached = new bool[cfg->nr_blocks];
+    int *changes = new int[cfg->nr_blocks];
+    value_range *current = new value_range[nr];
+    value_range *edge = new value_range[nr];
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        reached[b] = false;
+        changes[b] = 0;
+    }
+    for (int t = 0; t < nr; t++) {
+        in[t] = no_range;
+    }
+    reached[0] = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < cfg->nr_reachable; i++) {
+            int b = cfg->order[i];
+            basic_block *block = cfg->blocks[b];
+            if (!reached[b]) {
+                continue;
+            }
+            memcpy(current, &in[b * nr], nr * sizeof(value_range));
+            for (int j = 0; j < block->nr_quads; j++) {
+                transfer_ranges(block->quads[j], current);
+            }
+            for (int s = 0; s < block->nr_succ; s++) {
+                int succ = block->succ[s];
+                memcpy(edge, current, nr * sizeof(value_range));
+                bool back_edge = cfg->rpo_nr[succ] <= cfg->rpo_nr[b];
+                if (refine_ranges(block, s, edge) &&
+                    join_ranges(&in[succ * nr], edge, nr_tracked,
+                                &reached[succ], &changes[succ], back_edge)) {
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Remove the checks, and count the ones left in loops.
+    cfg->find_loops();
+    for (int b = 0; b < cfg->nr_blocks; b++) {
+        basic_block *block = cfg->blocks[b];
+        bool in_loop = is_in_loop(b);
+        memcpy(current, &in[b * nr], nr * sizeof(value_range));
+        for (int j = 0; j < block->nr_quads; j++) {
+            quadruple *q = block->quads[j];
+            if (q->op_code == q_bounds) {
+                value_range r = range_of(current, q->sym1);
+                if (reached[b] && r.lo >= 0 && r.hi < q->int2) {
+                    q->op_code = q_nop;
+                    continue;
+                }
+                nr_checks_left++;
+                if (in_loop) {
+                    nr_checks_in_loops++;
+                }
+            }
+            transfer_ranges(q, current);
+        }
+    }
+
+    delete[] in;
+    delete[] reached;
+    delete[] changes;
+    delete[] current;
+    delete[] edge;
+    delete[] tracked;
+    tracked = NULL;
+}
+
+
+
+/* Give the temporaries still used new offsets next to each other, and
+   shrink the activation record accordingly. The temporaries are allocated
+   after all the declared variables, and are only used by this quad list, so
+   they can be moved. Nothing is done unless they make up the end of the
+   activation record. */
+void quad_optimizer::pack_frame()
+{
+    sym_index env = sym_tab->current_environment();
+    int ar_size = sym_tab->get_symbol_size(env);
+    int base = ar_size;
+    int end = 0;
+
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        if (!cfg->named.test(v) && !cfg->nonlocal.test(v)) {
+            int offset = sym_tab->get_symbol_offset(cfg->vars[v]);
+            int size = sym_tab->get_symbol_size(cfg->vars[v]);
+            if (offset < base) {
+                base = offset;
+            }
+            if (offset + size > end) {
+                end = offset + size;
+            }
+        }
+    }
+    if (end != ar_size) {
+        return;
+    }
+
+    int offset = base;
+    for (int v = 0; v < cfg->nr_vars; v++) {
+        if (!cfg->named.test(v) && !cfg->nonlocal.test(v) &&
+            def_count[v] + use_count[v] > 0) {
+            sym_tab->set_symbol_offset(cfg->vars[v], offset);
+            offset += sym_tab->get_symbol_size(cfg->vars[v]);
+        }
+    }
+    sym_tab->set_ar_size(env, offset);
+}
@@ -0,0 +1,215 @@
+#ifndef __QUADOPT_HH__
+#define __QUADOPT_HH__
+
+#include "quads.hh"
+#include "cfg.hh"
+
+
+/*** This class performs optimisation on the quad list of a block, after
+     the AST optimizer and quad generation are done with it. The list is
+     split into a control flow graph (see cfg.hh), each pass works on the
+     graph, and a new quad list is built from it at the end. Before that,
+     calls to small procedures and functions compiled earlier are replaced
+     by a copy of their quads, with their parameters and local variables
+     renamed to temporaries of the caller, and the calls a subprogram makes
+     to itself in tail position are replaced by a jump to its start. Local
+     value numbering finds pure quads computing a value already held by
+     some variable in the same basic block, turns them into copies, and
+     makes the following quads read the first variable instead. Copies are
+     then propagated or coalesced with the quad computing their source,
+     quads whose results are never read are removed, and loop invariant
+     quads are hoisted into a pre-header in front of their loop. Counted
+     loops may also be unrolled, see the -u flag. With bounds checking on,
+     a range analysis removes the checks of indices known to be in range.
+     Finally, the temporaries that are left are packed in the activation
+     record. ***/
+
+
+class quad_optimizer;
+
+// Defined in quadopt.cc.
+extern quad_optimizer *quad_opt;
+
+
+// Procedures and functions with at most this many quads, not counting
+// labels, are inlined.
+const int MAX_INLINE_SIZE = 24;
+
+// The most quads inlining may add to a single quad list.
+const int MAX_INLINE_GROWTH = 400;
+
+// Loops are unrolled only if the copies of the body have at most this many
+// quads.
+const int MAX_UNROLL_SIZE = 256;
+
+
+// The range of values an integer variable may have. LONG_MIN and LONG_MAX
+// stand for no lower and no upper bound.
+struct value_range
+{
+    long lo;
+    long hi;
+};
+
+
+// The quads of a procedure or function that can be inlined.
+struct inline_body
+{
+    quadruple **quads;
+    int nr_quads;
+    int last_label;
+
+    // The parameters in declaration order, followed by the other variables
+    // of the body, ie, the symbols renamed at each call.
+    sym_index *locals;
+    int nr_locals;
+    int nr_params;
+
+    // The labels of the body, which are also renamed.
+    int *labels;
+    int nr_labels;
+};
+
+
+// An entry in the table of values computed in a basic block.
+struct value_entry
+{
+    quad_op_type op;
+    long a;
+    long b;
+    // Memory version, for array reads. 0 for other quads.
+    long memory;
+    // Value nr, or -1 for an empty slot.
+    int value;
+};
+
+
+class quad_optimizer
+{
+private:
+    // The graph of the quad list being optimized.
+    control_flow_graph *cfg;
+
+    // --- Inlining. ---
+
+    // The bodies of the procedures and functions compiled so far that can
+    // be inlined, indexed by sym_index. NULL for the others.
+    inline_body **bodies;
+    int bodies_size;
+
+    int parameters_of(sym_index);
+    void remember_body(sym_index, quad_list *);
+    quad_list *inline_calls(quad_list *);
+    void inline_call(quad_list &, inline_body *, quadruple **, sym_index);
+
+    // --- Tail calls. ---
+
+    quad_list *eliminate_tail_calls(quad_list *);
+
+    // --- Local value numbering. ---
+
+    // The value nr each variable holds, indexed by variable nr.
+    int *var_value;
+
+    // When the value was given. A value given before the current block is
+    // stale, and so is the value of a named variable given before the last
+    // call, which may have written it. A variable without a value gets a
+    // new one when it's read.
+    long *var_stamp;
+    long stamp;
+    long block_stamp;
+    long call_stamp;
+
+    // A variable holding each value, or NULL_SYM.
+    sym_index *value_holder;
+    int nr_values;
+    int values_size;
+
+    // Values computed in the current block, an open hash table. The used
+    // slots are listed so they can be cleared quickly.
+    value_entry *value_table;
+    int value_table_size;
+    int *used_slots;
+    int nr_used;
+
+    // Bumped by every store and call, so array reads before them are not
+    // reused after them.
+    long memory_version;
+
+    void start_numbering();
+    void end_numbering();
+    int new_value(sym_index);
+    bool has_value(int);
+    int value_nr(int);
+    long value_of(sym_index);
+    sym_index holder_of(sym_index);
+    value_entry *find_value(quad_op_type, long, long, long);
+    void number_values(basic_block *);
+    void number_all_values();
+
+    // --- Copies and dead code. ---
+
+    // Nr of quads writing and reading each variable, indexed by variable nr.
+    int *def_count;
+    int *use_count;
+
+    void count_uses();
+    void replace_uses(sym_index, sym_index);
+    void propagate_copies();
+    void coalesce_copies(basic_block *);
+    bool eliminate_dead_code();
+    void remove_nops();
+    void remove_copies_and_dead_code();
+
+    // --- Loop invariant code motion. ---
+
+    // The quads to be placed in front of each loop header, by block nr.
+    basic_block **preheaders;
+
+    bool hoist_invariants();
+    bool hoist_loop(natural_loop *, liveness *, int *);
+    void insert_preheaders();
+
+    // --- Loop unrolling. ---
+
+    bool unroll_loops();
+    bool unroll_loop(natural_loop *, liveness *, int *);
+
+    // --- Bounds check elimination. ---
+
+    // The position of each variable nr in the range tables, or -1 for the
+    // variables whose ranges aren't needed.
+    int *tracked;
+    int nr_tracked;
+
+    void find_tracked();
+    value_range range_of(value_range *, sym_index);
+    void transfer_ranges(quadruple *, value_range *);
+    bool narrow_operand(basic_block *, int, sym_index, value_range,
+                        value_range *);
+    bool refine_ranges(basic_block *, int, value_range *);
+    bool is_in_loop(int);
+    void remove_bounds_checks();
+
+    void pack_frame();
+
+public:
+    quad_optimizer();
+
+    // This is the interface to parser.y. Returns the optimized quad list.
+    // The quads of the old list are reused.
+    quad_list *do_optimize(quad_list *);
+
+    // Counts the bounds checks of a quad list that isn't optimized, for
+    // the report in parser.y.
+    void count_bounds_checks(quad_list *);
+
+    // The bounds checks of the last quad list optimized or counted, the
+    // ones left after range analysis, and the ones of those inside loops.
+    int nr_checks;
+    int nr_checks_left;
+    int nr_checks_in_loops;
+};
+
+
+#endif
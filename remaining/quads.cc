@@ -6,6 +6,10 @@
 #include "quads.hh"
 using namespace std;
 
+// Defined in main.cc.
+extern bool optimize;
+extern bool bounds_check;
+
 /* This little #define is only here to suppress compiler warnings for methods
    not using the quad_list given to it as a parameter. */
 #define USE_Q { quad_list *foo = &q; foo = foo; }
@@ -265,13 +269,68 @@ sym_index ast_sub::generate_quads(quad_list &q)
     return do_binaryoperation(q, q_iminus, q_rminus, this);
 }
 
+/* Returns k if node is the integer literal 2^k, k >= 1, otherwise -1. Used
+   for strength reduction of multiplication, div and mod, which is an
+   optimization, so -f turns it off by always returning -1. */
+static int power_of_two(ast_expression *node)
+{
+    if (!optimize || node->tag != AST_INTEGER) {
+        return -1;
+    }
+    long value = node->get_ast_integer()->value;
+    if (value < 2 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    int k = 0;
+    while (value > 1) {
+        value >>= 1;
+        k++;
+    }
+    return k;
+}
+
+/* Emit a quad taking a variable and an integer argument, and return the
+   temporary it assigns. */
+static sym_index gen_shift_quad(quad_list &q, quad_op_type op, sym_index sym,
+                                long arg)
+{
+    sym_index temp_var = sym_tab->gen_temp_var(integer_type);
+    q += new quadruple(op, sym, arg, temp_var);
+    return temp_var;
+}
+
+/* Multiplication by 2^k is a left shift. The literal can be on either side;
+   it has no side effects, so it doesn't matter that it isn't evaluated in
+   order. */
 sym_index ast_mult::generate_quads(quad_list &q)
 {
     USE_Q;
     /* Your code here */
+    if (type == integer_type) {
+        int k = power_of_two(right);
+        ast_expression *other = left;
+        if (k < 0) {
+            k = power_of_two(left);
+            other = right;
+        }
+        if (k > 0) {
+            sym_index sym = other->generate_quads(q);
+            return gen_shift_quad(q, q_ishl, sym, k);
+        }
+    }
     return do_binaryoperation(q, q_imult, q_rmult, this);
 }
 
+/* Signed division by 2^k can't just shift, since div truncates towards zero
+   and an arithmetic shift rounds down. Negative dividends get 2^k - 1 added
+   first. The bias is made from the sign: x sar 63 is -1 for negative x and
+   0 otherwise, and masking that with 2^k - 1 gives the bias or 0. */
+static sym_index gen_division_bias(quad_list &q, sym_index sym, int k)
+{
+    sym_index sign = gen_shift_quad(q, q_isar, sym, 63);
+    return gen_shift_quad(q, q_iand_mask, sign, (1L << k) - 1);
+}
+
 sym_index ast_divide::generate_quads(quad_list &q)
 {
     USE_Q;
@@ -279,17 +338,39 @@ sym_index ast_divide::generate_quads(quad_list &q)
     return do_binaryoperation(q, q_nop, q_rdivide, this);
 }
 
+/* x div 2^k = (x + bias) sar k, see gen_division_bias(). */
 sym_index ast_idiv::generate_quads(quad_list &q)
 {
     USE_Q;
     /* Your code here */
+    int k = power_of_two(right);
+    if (k > 0) {
+        sym_index sym = left->generate_quads(q);
+        sym_index bias = gen_division_bias(q, sym, k);
+        sym_index biased = sym_tab->gen_temp_var(integer_type);
+        q += new quadruple(q_iplus, sym, bias, biased);
+        return gen_shift_quad(q, q_isar, biased, k);
+    }
     return do_binaryoperation(q, q_idivide, q_nop, this);
 }
 
+/* mod takes the sign of the dividend, so x mod 2^k is
+   ((x + bias) and (2^k - 1)) - bias, see gen_division_bias(). */
 sym_index ast_mod::generate_quads(quad_list &q)
 {
     USE_Q;
     /* Your code here */
+    int k = power_of_two(right);
+    if (k > 0) {
+        sym_index sym = left->generate_quads(q);
+        sym_index bias = gen_division_bias(q, sym, k);
+        sym_index biased = sym_tab->gen_temp_var(integer_type);
+        q += new quadruple(q_iplus, sym, bias, biased);
+        sym_index low = gen_shift_quad(q, q_iand_mask, biased, (1L << k) - 1);
+        sym_index temp_var = sym_tab->gen_temp_var(integer_type);
+        q += new quadruple(q_iminus, low, bias, temp_var);
+        return temp_var;
+    }
     return do_binaryoperation(q, q_imod, q_nop, this);
 }
 
@@ -375,10 +456,25 @@ void ast_id::generate_assignment(quad_list &q, sym_index rhs)
     }
 }
 
+/* With bounds checking on, an index is checked against the size of the
+   array before it is used. The check traps at run time unless
+   0 <= index < array_cardinality. */
+static void generate_bounds_check(quad_list &q, sym_index array,
+                                  sym_index index)
+{
+    if (bounds_check) {
+        array_symbol *arr = sym_tab->get_symbol(array)->get_array_symbol();
+        q += new quadruple(q_bounds, index, arr->array_cardinality,
+                           NULL_SYM);
+    }
+}
+
+
 //TODO: We changed "type" to "id->type"
 void ast_indexed::generate_assignment(quad_list &q, sym_index rhs)
 {
     sym_index index_pos = index->generate_quads(q);
+    generate_bounds_check(q, id->sym_p, index_pos);
     sym_index address = sym_tab->gen_temp_var(integer_type);
 
     q += new quadruple(q_lindex, id->sym_p, index_pos, address);
@@ -403,8 +499,8 @@ sym_index ast_assign::generate_quads(quad_list &q)
 
 
 /* Parameters need to be treated specially as well. What we do here is
-   to recurse from the last parameter forward. In this process we use the
-   nr_param pointer (which is incremented by one for each recursive call)
+   to walk from the last parameter forward. In this process we use the
+   nr_param pointer (which is incremented by one for each parameter)
    to get the total number of parameters so we can generate a correct q_call
    quad for the new function/procedure that the parameters belong to.
     */
@@ -413,13 +509,11 @@ void ast_expr_list::generate_parameter_list(quad_list &q,
         int *nr_params)
 {
     USE_Q;
-    sym_index param = last_expr->generate_quads(q);
-    q += new quadruple(q_param, param, NULL_SYM, NULL_SYM);
-    (*nr_params)++;
-    if (preceding != NULL)
-      preceding->generate_parameter_list(q, NULL, nr_params);
-    /* Your code here */
-
+    for (int i = nr_exprs - 1; i >= 0; i--) {
+        sym_index param = exprs[i]->generate_quads(q);
+        q += new quadruple(q_param, param, NULL_SYM, NULL_SYM);
+        (*nr_params)++;
+    }
 }
 
 
@@ -527,12 +621,9 @@ void ast_elsif_list::generate_quads_and_jump(quad_list &q, int label)
 {
     USE_Q;
     /* Your code here */
-    if (preceding != NULL)
-    {
-      preceding->generate_quads_and_jump(q, label);
+    for (int i = 0; i < nr_elsifs; i++) {
+        elsifs[i]->generate_quads_and_jump(q, label);
     }
-
-    last_elsif->generate_quads_and_jump(q, label);
 }
 
 
@@ -608,6 +699,7 @@ sym_index ast_indexed::generate_quads(quad_list &q)
     USE_Q;
     /* Your code here */
     sym_index i = index->generate_quads(q);
+    generate_bounds_check(q, id->sym_p, i);
 
     sym_index address;
 
@@ -628,11 +720,10 @@ sym_index ast_indexed::generate_quads(quad_list &q)
    the most efficient way to do it... Why not? */
 sym_index ast_stmt_list::generate_quads(quad_list &q)
 {
-    if (preceding != NULL) {
-        preceding->generate_quads(q);
-    }
-    if (last_stmt != NULL) {
-        last_stmt->generate_quads(q);
+    for (int i = 0; i < nr_stmts; i++) {
+        if (stmts[i] != NULL) {
+            stmts[i]->generate_quads(q);
+        }
     }
     return NULL_SYM;
 }
@@ -794,6 +885,24 @@ void quadruple::print(ostream &o)
           << setw(11) << sym_tab->get_symbol(sym2)
           << setw(11) << sym_tab->get_symbol(sym3);
         break;
+    case q_ishl:
+        o << setw(11) << "q_ishl"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << int2
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_isar:
+        o << setw(11) << "q_isar"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << int2
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
+    case q_iand_mask:
+        o << setw(11) << "q_iand_mask"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << int2
+          << setw(11) << sym_tab->get_symbol(sym3);
+        break;
     case q_req:
         o << setw(11) << "q_req"
           << setw(11) << sym_tab->get_symbol(sym1)
@@ -902,6 +1011,12 @@ void quadruple::print(ostream &o)
           << setw(11) << sym_tab->get_symbol(sym2)
           << setw(11) << sym_tab->get_symbol(sym3);
         break;
+    case q_bounds:
+        o << setw(11) << "q_bounds"
+          << setw(11) << sym_tab->get_symbol(sym1)
+          << setw(11) << int2
+          << setw(11) << "-";
+        break;
     case q_itor:
         o << setw(11) << "q_itor"
           << setw(11) << sym_tab->get_symbol(sym1)
@@ -27,6 +27,9 @@ typedef enum {
     q_rdivide,     // sym, sym, sym
     q_idivide,     // sym, sym, sym
     q_imod,        // sym, sym, sym
+    q_ishl,        // sym, int, sym
+    q_isar,        // sym, int, sym
+    q_iand_mask,   // sym, int, sym
     q_req,         // sym, sym, sym
     q_ieq,         // sym, sym, sym
     q_rne,         // sym, sym, sym
@@ -45,6 +48,7 @@ typedef enum {
     q_lindex,      // sym, sym, sym
     q_rrindex,     // sym, sym, sym
     q_irindex,     // sym, sym, sym
+    q_bounds,      // sym, int, -
     q_itor,        // sym, -, sym
     q_jmp,         // int, -, -
     q_jmpf,        // int, sym, -
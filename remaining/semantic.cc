@@ -43,7 +43,7 @@ bool semantic::chk_param(ast_id *env,
                         ast_expr_list *actuals)
 {
     /* Your code here */
-    position_information *pos;
+    position_information pos;
     if (actuals != NULL)
     {
         pos = actuals->pos;
@@ -52,9 +52,11 @@ bool semantic::chk_param(ast_id *env,
     {
         pos = env->pos;
     }
-    while(formals != NULL || actuals != NULL)
+    // Both lists are compared from the last parameter backwards.
+    int i = actuals != NULL ? actuals->nr_exprs - 1 : -1;
+    while(formals != NULL || i >= 0)
     {
-        if (actuals == NULL){
+        if (i < 0){
             type_error(pos) << "More formal than actual parameters.\n";
             break;
         }
@@ -62,13 +64,13 @@ bool semantic::chk_param(ast_id *env,
             type_error(pos) << "More actual than formal parameters.\n";
             break;
         }
-        if (formals->type != actuals->last_expr->type_check())
+        if (formals->type != actuals->exprs[i]->type_check())
         {
             type_error(pos) << "Type discrepancy between formal and actual parameters.\n";
             return true;
         }
         formals = formals->preceding;
-        actuals = actuals->preceding;
+        i--;
     }
     return true;
 }
@@ -80,13 +82,14 @@ void semantic::check_parameters(ast_id *call_id,
 {
     /* Your code here */
     symbol *tmp = sym_tab->get_symbol(call_id->sym_p);
-    if (tmp->tag == SYM_FUNC)
+    sym_type tag = sym_tab->get_symbol_tag(call_id->sym_p);
+    if (tag == SYM_FUNC)
     {
         function_symbol *func = tmp->get_function_symbol();
         parameter_symbol *decl_params = func->last_parameter;
         chk_param(call_id, decl_params, param_list);
     }
-    else if (tmp->tag == SYM_PROC)
+    else if (tag == SYM_PROC)
     {
         procedure_symbol *proc = tmp->get_procedure_symbol();
         parameter_symbol *decl_params = proc->last_parameter;
@@ -118,24 +121,32 @@ sym_index ast_statement::type_check()
 }
 
 sym_index ast_expression::type_check()
+{
+    if (checked_type == NULL_SYM) {
+        checked_type = compute_type();
+    }
+    return checked_type;
+}
+
+sym_index ast_expression::compute_type()
 {
     fatal("Trying to type check abstract class ast_expression.");
     return void_type;
 }
 
-sym_index ast_lvalue::type_check()
+sym_index ast_lvalue::compute_type()
 {
     fatal("Trying to type check abstract class ast_lvalue.");
     return void_type;
 }
 
-sym_index ast_binaryoperation::type_check()
+sym_index ast_binaryoperation::compute_type()
 {
     fatal("Trying to type check abstract class ast_binaryoperation.");
     return void_type;
 }
 
-sym_index ast_binaryrelation::type_check()
+sym_index ast_binaryrelation::compute_type()
 {
     fatal("Trying to type check abstract class ast_binaryrelation.");
     return void_type;
@@ -146,36 +157,35 @@ sym_index ast_binaryrelation::type_check()
 /* Type check a list of statements. */
 sym_index ast_stmt_list::type_check()
 {
-    if (preceding != NULL) {
-        preceding->type_check();
-    }
-    if (last_stmt != NULL) {
-        last_stmt->type_check();
+    for (int i = 0; i < nr_stmts; i++) {
+        if (stmts[i] != NULL) {
+            stmts[i]->type_check();
+        }
     }
     return void_type;
 }
 
 
-/* Type check a list of expressions. */
+/* Type check a list of expressions, last one first. */
 sym_index ast_expr_list::type_check()
 {
     /* Your code here */
-    last_expr->type_check();
-    preceding->type_check();
+    for (int i = nr_exprs - 1; i >= 0; i--) {
+        exprs[i]->type_check();
+    }
 
     return void_type;
 }
 
 
 
-/* Type check an elsif list. */
+/* Type check an elsif list, last clause first. */
 sym_index ast_elsif_list::type_check()
 {
     /* Your code here */
-    
-    last_elsif->type_check();
-    if (preceding != NULL)
-        preceding->type_check();
+    for (int i = nr_elsifs - 1; i >= 0; i--) {
+        elsifs[i]->type_check();
+    }
 
     return void_type;
 }
@@ -185,20 +195,19 @@ sym_index ast_elsif_list::type_check()
 /* "type check" an indentifier. We need to separate nametypes from other types
    here, since all nametypes are of type void, but should return an index to
    itself in the symbol table as far as typechecking is concerned. */
-sym_index ast_id::type_check()
+sym_index ast_id::compute_type()
 {
-    if (sym_tab->get_symbol(sym_p)->tag != SYM_NAMETYPE) {
+    if (sym_tab->get_symbol_tag(sym_p) != SYM_NAMETYPE) {
         return type;
     }
     return sym_p;
 }
 
 
-sym_index ast_indexed::type_check()
+sym_index ast_indexed::compute_type()
 {
     /* Your code here */
-    symbol *arr = sym_tab->get_symbol(id->sym_p);
-    if (arr->tag != SYM_ARRAY)
+    if (sym_tab->get_symbol_tag(id->sym_p) != SYM_ARRAY)
     {
         error(pos) << "Can't index non-array identifier!\n";
         return void_type;
@@ -207,7 +216,7 @@ sym_index ast_indexed::type_check()
     {
         type_error(index->pos) << "Index must be of type integer!\n";
     }
-    return arr->type;
+    return sym_tab->get_symbol_type(id->sym_p);
 }
 
 
@@ -251,21 +260,21 @@ sym_index semantic::check_binop1(ast_binaryoperation *node)
 }
 
 
-sym_index ast_add::type_check()
+sym_index ast_add::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop1(this);
     return type;
 }
 
-sym_index ast_sub::type_check()
+sym_index ast_sub::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop1(this);
     return type;
 }
 
-sym_index ast_mult::type_check()
+sym_index ast_mult::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop1(this);
@@ -274,7 +283,7 @@ sym_index ast_mult::type_check()
 
 /* Divide is a special case, since it always returns real. We make sure the
    operands are cast to real too as needed. */
-sym_index ast_divide::type_check()
+sym_index ast_divide::compute_type()
 {
     /* Your code here */
     sym_index left_type = left->type_check();//TODO: type_check on ast_expression?
@@ -323,28 +332,28 @@ sym_index semantic::check_binop2(ast_binaryoperation *node, string s)
     return integer_type;
 }
 
-sym_index ast_or::type_check()
+sym_index ast_or::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop2(this, "Both operands of a or (bool) operation must be integers!");
     return type;
 }
 
-sym_index ast_and::type_check()
+sym_index ast_and::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop2(this, "Both operands of an and (bool) operation must be integers!");
     return type;
 }
 
-sym_index ast_idiv::type_check()
+sym_index ast_idiv::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop2(this, "Both operands of an integer division must be integers!");
     return type;
 }
 
-sym_index ast_mod::type_check()
+sym_index ast_mod::compute_type()
 {
     /* Your code here */
     type = type_checker->check_binop2(this, "Both operands of a mod operation must be integers!");
@@ -376,25 +385,25 @@ sym_index semantic::check_binrel(ast_binaryrelation *node)
     return integer_type;
 }
 
-sym_index ast_equal::type_check()
+sym_index ast_equal::compute_type()
 {
     /* Your code here */
     return type_checker->check_binrel(this);
 }
 
-sym_index ast_notequal::type_check()
+sym_index ast_notequal::compute_type()
 {
     /* Your code here */
     return type_checker->check_binrel(this);
 }
 
-sym_index ast_lessthan::type_check()
+sym_index ast_lessthan::compute_type()
 {
     /* Your code here */
     return type_checker->check_binrel(this);
 }
 
-sym_index ast_greaterthan::type_check()
+sym_index ast_greaterthan::compute_type()
 {
     /* Your code here */
     return type_checker->check_binrel(this);
@@ -517,7 +526,7 @@ sym_index ast_return::type_check()
     return void_type;
 }
 
-sym_index ast_functioncall::type_check()
+sym_index ast_functioncall::compute_type()
 {
     /* Your code here */
     type_checker->check_parameters(id, parameter_list);
@@ -525,7 +534,7 @@ sym_index ast_functioncall::type_check()
     return type;
 }
 
-sym_index ast_uminus::type_check()
+sym_index ast_uminus::compute_type()
 {
     /* Your code here */
     sym_index t = expr->type_check();
@@ -538,7 +547,7 @@ sym_index ast_uminus::type_check()
     //return void_type
 }
 
-sym_index ast_not::type_check()
+sym_index ast_not::compute_type()
 {
     /* Your code here */
     sym_index t = expr->type_check();
@@ -566,12 +575,12 @@ sym_index ast_elsif::type_check()
 
 
 
-sym_index ast_integer::type_check()
+sym_index ast_integer::compute_type()
 {
     return integer_type;
 }
 
-sym_index ast_real::type_check()
+sym_index ast_real::compute_type()
 {
     return real_type;
 }
\ No newline at end of file
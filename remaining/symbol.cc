@@ -12,6 +12,9 @@ symbol::symbol(pool_index pool_p)
     // All symbols are tagged as SYM_UNDEF at creation.
     // This is used later to check for redeclarations.
     tag = SYM_UNDEF;
+    type = void_type;
+    level = 0;
+    offset = 0;
 }
 
 
@@ -32,7 +35,6 @@ constant_symbol::constant_symbol(const pool_index pool_p) :
 
 
 /* Constructor for variable_symbol. */
-/* NOTE: Maybe always set the type to void_type here, too? */
 variable_symbol::variable_symbol(const pool_index pool_p) :
     symbol(pool_p)
 {
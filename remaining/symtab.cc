@@ -6,6 +6,10 @@
 #include <iostream>
 #include <ctype.h>
 #include <string.h>
+#include <new>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "symtab.hh"
 
 using namespace std;
@@ -20,6 +24,115 @@ sym_index real_type;
 
 
 
+/*** The memory_arena class. ***/
+
+memory_arena::memory_arena()
+{
+    current = NULL;
+    next = NULL;
+    limit = NULL;
+}
+
+
+memory_arena::~memory_arena()
+{
+    release();
+}
+
+
+/* Link in a fresh chunk. Normal chunks are ARENA_CHUNK_SIZE bytes; a
+   request that doesn't fit in one gets a chunk of its own. */
+void memory_arena::new_chunk(long size)
+{
+    long chunk_size = ARENA_CHUNK_SIZE;
+    if (size + (long) sizeof(chunk) > chunk_size) {
+        chunk_size = size + sizeof(chunk);
+    }
+
+    chunk *c = (chunk *) new char[chunk_size];
+    c->prev = current;
+    current = c;
+    next = (char *) c + sizeof(chunk);
+    limit = (char *) c + chunk_size;
+}
+
+
+/* Bump allocate size bytes. Everything is aligned for the strictest type
+   a symbol or AST node can contain, ie, a double or a pointer. */
+void *memory_arena::allocate(long size)
+{
+    const long align = sizeof(double) > sizeof(void *) ?
+                       sizeof(double) : sizeof(void *);
+    size = (size + align - 1) & ~(align - 1);
+
+    if (next == NULL || limit - next < size) {
+        new_chunk(size);
+    }
+
+    void *p = next;
+    next += size;
+    return p;
+}
+
+
+/* Free all chunks. Any symbol pointers handed out are invalid after this. */
+void memory_arena::release()
+{
+    while (current != NULL) {
+        chunk *prev = current->prev;
+        delete[] (char *) current;
+        current = prev;
+    }
+    next = NULL;
+    limit = NULL;
+}
+
+
+
+/*** Block arenas. ***/
+
+// The stack of block arenas, innermost block first.
+struct block_arena {
+    memory_arena arena;
+    block_arena *prev;
+};
+
+static block_arena *block_arenas = NULL;
+
+
+/* Start allocating from a new, empty arena. */
+void push_block_arena()
+{
+    block_arena *b = new block_arena;
+    b->prev = block_arenas;
+    block_arenas = b;
+}
+
+
+/* Free everything allocated since the matching push_block_arena(). */
+void pop_block_arena()
+{
+    if (block_arenas == NULL) {
+        fatal("pop_block_arena: No block arena to pop");
+    }
+    block_arena *b = block_arenas;
+    block_arenas = b->prev;
+    delete b;
+}
+
+
+/* Allocate memory from the innermost block arena, or from the heap if there
+   is none. */
+void *block_allocate(size_t size)
+{
+    if (block_arenas == NULL) {
+        return ::operator new(size);
+    }
+    return block_arenas->arena.allocate(size);
+}
+
+
+
 /*** The symbol_table class - watch out, it's big. ***/
 
 /* Constructor: allocates the data members. The symbol table itself is just
@@ -44,27 +157,50 @@ symbol_table::symbol_table()
     string_pool = new char[pool_length];
     string_pool[0] = '\0';
 
+    // The intern table starts out empty.
+    intern_size = BASE_INTERN_SIZE;
+    intern_count = 0;
+    intern_table = new pool_index[intern_size];
+    for (long i = 0; i < intern_size; i++) {
+        intern_table[i] = NULL_POOL;
+    }
+
     // --- Initialize hash table. ---
-    hash_table = new sym_index[MAX_HASH];
-    for (int i = 0; i < MAX_HASH; i++) {
-        hash_table[i] = NULL_SYM;
+    hash_size = BASE_HASH_SIZE;
+    hash_count = 0;
+    hash_table = new hash_slot[hash_size];
+    for (hash_index i = 0; i < hash_size; i++) {
+        hash_table[i].id = NULL_POOL;
+        hash_table[i].sym = NULL_SYM;
     }
 
     // --- Initialize display. ---
     // The block_table will keep track of the current lexical level
-    // global level is 0
+    // global level is 0. It is doubled in open_scope() when needed.
     current_level = 0;
-    block_table = new sym_index[MAX_BLOCK];
-    for (int i = 0; i < MAX_BLOCK; i++) {
+    block_size = BASE_BLOCK_SIZE;
+    block_table = new sym_index[block_size];
+    undo_mark = new long[block_size];
+    for (int i = 0; i < block_size; i++) {
         block_table[i] = 0;
+        undo_mark[i] = 0;
     }
 
+    // The undo log records every symbol entered in the hash table, so
+    // close_scope() knows which slots to restore.
+    undo_size = BASE_SYM_SIZE;
+    undo_pos = 0;
+    undo_log = new sym_index[undo_size];
+
     // --- Initialize symbol table. ---
-    // Weird syntax, gives us a table of pointers to symbols.
-    sym_table = new symbol*[MAX_SYM];
-    for (int i = 0; i < MAX_SYM; i++) {
+    // Weird syntax, gives us a table of pointers to symbols. It is doubled
+    // in install_symbol() when needed.
+    sym_size = BASE_SYM_SIZE;
+    sym_table = new symbol*[sym_size];
+    for (int i = 0; i < sym_size; i++) {
         sym_table[i] = NULL;
     }
+    hot_alloc(sym_size);
 
     label_nr = -1;
     temp_nr = 0;
@@ -80,7 +216,7 @@ symbol_table::symbol_table()
         return;
     }
     // This is just a dummy position for the preinstalled functions.
-    position_information *dummy_pos = new position_information();
+    position_information dummy_pos;
 
     // This "empty" symbol represents the global level.
     enter_procedure(dummy_pos, pool_install(capitalize("global.")));
@@ -136,6 +272,11 @@ symbol_table::symbol_table()
     truc->get_function_symbol()->last_parameter = par;
 
     sym_table[0]->get_procedure_symbol()->last_parameter = NULL;
+
+    // Some fields were set by hand above.
+    for (sym_index i = 0; i <= sym_pos; i++) {
+        sync_hot(i);
+    }
 }
 
 
@@ -171,19 +312,10 @@ long symbol_table::get_next_label()
    an error. This method is used for quad generation. */
 sym_index symbol_table::gen_temp_var(sym_index type)
 {
-    /* Your code here */
-
     string temp_name = "$";
     temp_name = temp_name + to_string(++sym_tab->temp_nr);
 
-    //const char * ayy_lmao = temp_name.c_str();
-    
-    char * a = (char *) calloc(temp_name.length(), sizeof(char));
-
-    strcpy( a, temp_name.c_str() );
-    
-
-    pool_index pool_p = pool_install(a);
+    pool_index pool_p = pool_install(temp_name.c_str());
     
     if (type == integer_type)
     {
@@ -232,14 +364,10 @@ void symbol_table::print(int detail)
 {
     if (detail == 2) {
         if (pool_pos > 0) {
-            unsigned int pos = 0;
-            while (pos < strlen(string_pool)) {
-                unsigned int len = (int) string_pool[pos];
-                cout << len;
-                for (unsigned int k = pos + 1; k < pos + len + 1; k++) {
-                    cout << string_pool[k];
-                }
-                pos += len + 1;
+            pool_index pos = 0;
+            while (pos < pool_pos) {
+                cout << pool_strlen(pos) << pool_lookup(pos);
+                pos += POOL_HEADER_SIZE + pool_strlen(pos) + 1;
             }
             cout << endl;
 
@@ -256,9 +384,9 @@ void symbol_table::print(int detail)
 
     if (detail == 3) {
         cout << "Hash table:\n";
-        for (int j = 0; j < MAX_HASH; j++) {
-            if (hash_table[j]) {
-                cout << j << ": " << hash_table[j] << endl;
+        for (hash_index j = 0; j < hash_size; j++) {
+            if (hash_table[j].sym != NULL_SYM) {
+                cout << j << ": " << hash_table[j].sym << endl;
             }
         }
         return;
@@ -371,11 +499,13 @@ void symbol_table::print(int detail)
 
 char *symbol_table::capitalize(const char *s)
 {
+    size_t len = strlen(s);
+
     // The result string.
-    char *capitalized_s = new char[strlen(s) + 1];
+    char *capitalized_s = new char[len + 1];
 
-    unsigned int i;
-    for (i = 0; i < strlen(s); i++) {
+    size_t i;
+    for (i = 0; i < len; i++) {
         capitalized_s[i] = (unsigned char) toupper(s[i]);
     }
     capitalized_s[i] = '\0';
@@ -383,79 +513,272 @@ char *symbol_table::capitalize(const char *s)
     return capitalized_s;
 }
 
-/* Install a string into the pool table and return its index.
-   The table is on the form <string1 length>string1<string2 length>string2...
-   Note that the null char denotes the end of the entire pool,
-   NOT the separator of two strings. It is appended in pool_lookup, though.
-   Snapshot:
-   7INTEGER4REAL4READ5WRITE4PROG1A\0
-                  ^
-                  pool_pos
-*/
+/* Uses the hash_x33 algorithm. Computes the hash value of a string of the
+   given length. This is only done once per string, in pool_install(). */
+static unsigned int hash_x33(const char *s, int len)
+{
+    // Magical hash value variable.
+    unsigned int h = 0;
+    // Calculate the hash value.
+    while (len > 0) {
+        h = (h << 5) + h + *s++;
+        len--;
+    }
+    return h;
+}
+
 
-pool_index symbol_table::pool_install(char *s)
+/* Return the intern table slot holding the given string, or the empty slot
+   where it would be inserted. We use linear probing, and compare the cached
+   hashes and lengths before looking at any characters. */
+long symbol_table::intern_slot(const char *s, int len, unsigned int h)
 {
-    // Make sure pool is not full. If it is, double pool size.
-    if (pool_pos + (int) strlen(s) >= pool_length) {
-        char *tmp_pool = new char[2 * pool_length];
+    long mask = intern_size - 1;
+    long i = h & mask;
+
+    while (intern_table[i] != NULL_POOL) {
+        pool_index p = intern_table[i];
+        if (pool_hash(p) == h &&
+                pool_strlen(p) == len &&
+                memcmp(pool_lookup(p), s, len) == 0) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
 
-        // Double pool size.
-        pool_length *= 2;
-        strcpy(tmp_pool, string_pool);
-        delete[] string_pool;
-        string_pool = tmp_pool;
+
+/* Double the size of the intern table and reinsert all strings. The hashes
+   are taken from the pool, so no string is rehashed. */
+void symbol_table::intern_grow()
+{
+    pool_index *old_table = intern_table;
+    long old_size = intern_size;
+
+    intern_size *= 2;
+    intern_table = new pool_index[intern_size];
+    for (long i = 0; i < intern_size; i++) {
+        intern_table[i] = NULL_POOL;
     }
 
-    // The return value, ie, the start of the string.
-    long old_pos = pool_pos;
+    long mask = intern_size - 1;
+    for (long i = 0; i < old_size; i++) {
+        if (old_table[i] != NULL_POOL) {
+            long j = pool_hash(old_table[i]) & mask;
+            while (intern_table[j] != NULL_POOL) {
+                j = (j + 1) & mask;
+            }
+            intern_table[j] = old_table[i];
+        }
+    }
+    delete[] old_table;
+}
+
+
+/* Install a string into the pool table and return its index. If the string
+   is already in the pool, the index of the earlier entry is returned, so
+   every spelling is stored once and equal strings have equal indexes.
+   The table is on the form <header>string1\0<header>string2\0... where the
+   header is the length of the string followed by its hash value. The null
+   chars let pool_lookup() hand out pointers into the pool without copying,
+   and the stored hash means we never have to walk a string again after it
+   has been installed.
+   Snapshot (the hash values are shown as #):
+   7#INTEGER\04#REAL\04#READ\05#WRITE\04#PROG\01#A\0
+                                           ^
+                                           pool_pos
+*/
+
+pool_index symbol_table::pool_install(const char *s)
+{
+    return pool_install(s, (int) strlen(s));
+}
 
-    // This is not really a pretty solution but it works for now. Some sort
-    // struct with length/char * would be a more general solution, since this
-    // way we're limited to strings that fit within 255 bytes.
-    if (strlen(s) >= 255) {
+
+/* Install the first len chars of s. s doesn't have to be null terminated,
+   which lets the scanner install token text straight from its buffer. */
+pool_index symbol_table::pool_install(const char *s, int len)
+{
+    return pool_install(s, len, hash_x33(s, len));
+}
+
+
+/* Strings must fit in a pool entry, whose length is kept in a byte.
+   Reports the error and returns true for longer ones. This is not really a
+   pretty solution but it works for now. Some sort of struct with
+   length/char * would be a more general solution. */
+static bool pool_too_long(int len)
+{
+    if (len >= 255) {
         fatal("symbol_table::pool_install: Too long string");
+        return true;
+    }
+    return false;
+}
+
+
+#if defined(__SSE2__)
+/* Upper case the first len chars of s into upper, 16 (or with AVX2, 32)
+   at a time, and return how many were done. The rest, fewer than 16, are
+   left to the caller. A char is folded by subtracting 'a' - 'A' where it
+   lies in 'a'..'z'. The compares are signed, so chars above 127 are left
+   alone like in the scalar loop. */
+static int fold_upper_vector(const char *s, char *upper, int len)
+{
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i below_a32 = _mm256_set1_epi8('a' - 1);
+    const __m256i above_z32 = _mm256_set1_epi8('z' + 1);
+    const __m256i delta32 = _mm256_set1_epi8('a' - 'A');
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(v, below_a32),
+                                         _mm256_cmpgt_epi8(above_z32, v));
+        v = _mm256_sub_epi8(v, _mm256_and_si256(lower, delta32));
+        _mm256_storeu_si256((__m256i *) (upper + i), v);
+    }
+#endif
+    const __m128i below_a = _mm_set1_epi8('a' - 1);
+    const __m128i above_z = _mm_set1_epi8('z' + 1);
+    const __m128i delta = _mm_set1_epi8('a' - 'A');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, below_a),
+                                      _mm_cmpgt_epi8(above_z, v));
+        v = _mm_sub_epi8(v, _mm_and_si128(lower, delta));
+        _mm_storeu_si128((__m128i *) (upper + i), v);
+    }
+    return i;
+}
+#endif
+
+
+/* Install the first len chars of s in upper case. Used by the scanner for
+   identifiers instead of pool_install(capitalize(...)). The case folding
+   goes into a buffer on the stack, so nothing is allocated unless the
+   identifier is new to the pool. Short identifiers, which are most of
+   them, are folded and hashed in the same loop. Longer ones are folded by
+   fold_upper_vector() where there is SSE2, and hashed afterwards, since
+   the hash is a serial chain the vector unit can't help with. Identifiers
+   are plain ASCII, see scanner.l. */
+pool_index symbol_table::pool_install_upper(const char *s, int len)
+{
+    // Don't overflow the buffer.
+    char upper[256];
+    if (pool_too_long(len)) {
         return 0;
     }
 
-    // First install the length of the string.
-    string_pool[pool_pos++] = (unsigned char) strlen(s);
-    string_pool[pool_pos] = '\0';
+    int i = 0;
+#if defined(__SSE2__)
+    if (len >= 16) {
+        i = fold_upper_vector(s, upper, len);
+    }
+#endif
+    unsigned int h = hash_x33(upper, i);
+    for (; i < len; i++) {
+        char c = s[i];
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+        upper[i] = c;
+        h = (h << 5) + h + c;
+    }
+
+    return pool_install(upper, len, h);
+}
 
-    // Add the string itself to the end of the pool.
-    strcat(string_pool, s);
+
+/* Install the first len chars of s, whose hash_x33 value is h. This is
+   where the work is done for the other pool_install variants. */
+pool_index symbol_table::pool_install(const char *s, int len, unsigned int h)
+{
+    if (pool_too_long(len)) {
+        return 0;
+    }
+
+    // Return the existing entry if we've seen this string before.
+    long slot = intern_slot(s, len, h);
+    if (intern_table[slot] != NULL_POOL) {
+        return intern_table[slot];
+    }
+
+    // Make sure pool is not full. If it is, double pool size until the new
+    // entry fits.
+    if (pool_pos + POOL_HEADER_SIZE + len + 1 > pool_length) {
+        while (pool_pos + POOL_HEADER_SIZE + len + 1 > pool_length) {
+            pool_length *= 2;
+        }
+        char *tmp_pool = new char[pool_length];
+        memcpy(tmp_pool, string_pool, pool_pos);
+        delete[] string_pool;
+        string_pool = tmp_pool;
+    }
+
+    // The return value, ie, the start of the entry.
+    long old_pos = pool_pos;
+
+    // First install the header: the length and the hash of the string.
+    string_pool[pool_pos] = (unsigned char) len;
+    memcpy(&string_pool[pool_pos + 1], &h, sizeof(h));
+    pool_pos += POOL_HEADER_SIZE;
+
+    // Add the string itself, null terminated, to the end of the pool.
+    memcpy(&string_pool[pool_pos], s, len);
+    string_pool[pool_pos + len] = '\0';
 
     // Move pool_pos to the end of the new entry.
-    pool_pos += strlen(s);
+    pool_pos += len + 1;
+
+    // Remember the new entry. Keep the table at most half full so the
+    // probe sequences stay short.
+    intern_table[slot] = old_pos;
+    intern_count++;
+    if (2 * intern_count > intern_size) {
+        intern_grow();
+    }
 
     return old_pos;
 }
 
 
-/* Allocate memory for and return a string given a pool_index. */
+/* Return a string given a pool_index. Nothing is allocated: the string is
+   null terminated inside the pool, so we point straight at it. */
 
-char *symbol_table::pool_lookup(const pool_index p)
+const char *symbol_table::pool_lookup(const pool_index p)
 {
     // Catch references to beyond last string.
     assert(p < pool_pos);
 
-    // Start points to first char of the sought string.
-    // We just use it to index the pool, it is never assigned to.
-    char *start = &string_pool[p + 1];
+    return &string_pool[p + POOL_HEADER_SIZE];
+}
+
+
+/* Return the length of a pooled string, read from the entry header. */
+
+int symbol_table::pool_strlen(const pool_index p)
+{
+    assert(p < pool_pos);
+
+    return (unsigned char) string_pool[p];
+}
 
-    // p points to the char holding the length of the sought string.
-    int length = (int) string_pool[p];
 
-    // We only want to return a string of length chars, plus
-    // one extra for the null terminator.
-    char *s = new char[length + 1];
-    strncpy(s, start, length);
-    s[length] = '\0';
+/* Return the hash value stored in the entry header by pool_install(). */
 
-    return s;
+unsigned int symbol_table::pool_hash(const pool_index p)
+{
+    assert(p < pool_pos);
+
+    unsigned int h;
+    memcpy(&h, &string_pool[p + 1], sizeof(h));
+    return h;
 }
 
 
-/* Compare two strings. */
+/* Compare two strings. pool_install() never stores the same string twice,
+   so two strings are equal exactly when their indexes are. */
 
 bool symbol_table::pool_compare(const pool_index pool_p1,
                                 const pool_index pool_p2)
@@ -463,7 +786,7 @@ bool symbol_table::pool_compare(const pool_index pool_p1,
     // Catch too large pos.
     assert(pool_p1 < pool_pos && pool_p2 < pool_pos);
 
-    return strcmp(pool_lookup(pool_p1), pool_lookup(pool_p2)) == 0;
+    return pool_p1 == pool_p2;
 }
 
 
@@ -471,15 +794,25 @@ bool symbol_table::pool_compare(const pool_index pool_p1,
 
 pool_index symbol_table::pool_forget(const pool_index pool_p)
 {
-    char *last_entry = pool_lookup(pool_p);
-
     // Make sure that this really is the last entry.
-    assert((pool_p + (int) strlen(last_entry)) == pool_pos - 1);
+    assert(pool_p + POOL_HEADER_SIZE + pool_strlen(pool_p) + 1 == pool_pos);
+
+    // Take it out of the intern table. The entries following it in the same
+    // probe sequence are reinserted so they can still be found.
+    long mask = intern_size - 1;
+    long i = intern_slot(pool_lookup(pool_p), pool_strlen(pool_p),
+                         pool_hash(pool_p));
+    intern_table[i] = NULL_POOL;
+    intern_count--;
+    for (i = (i + 1) & mask; intern_table[i] != NULL_POOL; i = (i + 1) & mask) {
+        pool_index p = intern_table[i];
+        intern_table[i] = NULL_POOL;
+        intern_table[intern_slot(pool_lookup(p), pool_strlen(p),
+                                 pool_hash(p))] = p;
+    }
 
     // Back up pool_pos one entry.
     pool_pos = pool_p;
-    // Terminate the string pool there.
-    string_pool[pool_pos] = '\0';
     // Mostly useful for debugging.
     return pool_pos;
 }
@@ -520,22 +853,52 @@ char *symbol_table::fix_string(const char *old_str)
 
 /*** Hash table methods. ***/
 
-/* Uses the hash_x33 algorithm. Returns an index into the symbol table
-   given a string. The string is probably attained using pool_lookup(). */
+/* Returns the hash value of a string. The hash_x33 value of the string was
+   computed once when it was installed in the pool. The hash table masks it
+   with its current size to get the home slot. */
 hash_index symbol_table::hash(const pool_index p)
 {
-    char *s = pool_lookup(p);
-    int len = (int) strlen(s);
-    // Magical hash value variable.
-    unsigned int h = 0;
-    // Calculate the hash value.
-    while (len > 0) {
-        h = (h << 5) + h + *s++;
-        len--;
+    return pool_hash(p);
+}
+
+
+/* Return the hash table slot holding the given name, or the empty slot where
+   it would be inserted. Names are interned, so the probe only compares
+   pool indexes. */
+hash_index symbol_table::hash_find(const pool_index pool_p)
+{
+    hash_index mask = hash_size - 1;
+    hash_index i = hash(pool_p) & mask;
+
+    while (hash_table[i].id != NULL_POOL && hash_table[i].id != pool_p) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+/* Double the size of the hash table and reinsert all names. Slots are never
+   freed, a name whose symbols have all gone out of scope keeps its slot with
+   sym set to NULL_SYM, so there are no tombstones to worry about. The number
+   of slots is bounded by the number of distinct names. */
+void symbol_table::hash_grow()
+{
+    hash_slot *old_table = hash_table;
+    hash_index old_size = hash_size;
+
+    hash_size *= 2;
+    hash_table = new hash_slot[hash_size];
+    for (hash_index i = 0; i < hash_size; i++) {
+        hash_table[i].id = NULL_POOL;
+        hash_table[i].sym = NULL_SYM;
+    }
+
+    for (hash_index i = 0; i < old_size; i++) {
+        if (old_table[i].id != NULL_POOL) {
+            hash_table[hash_find(old_table[i].id)] = old_table[i];
+        }
     }
-    // Memory leak since s is still allocated. However, since we've
-    // changed it, delete[] s is not a good idea at all.
-    return h % MAX_HASH;
+    delete[] old_table;
 }
 
 
@@ -555,29 +918,36 @@ void symbol_table::open_scope()
     /* Your code here */
     //cout << "opening scope\n";
     current_level++;
-    if (current_level >= MAX_BLOCK)
-        fatal("Block table full!");
+    if (current_level >= block_size) {
+        sym_index *old_table = block_table;
+        block_table = new sym_index[block_size * 2];
+        memcpy(block_table, old_table, block_size * sizeof(sym_index));
+        long *old_mark = undo_mark;
+        undo_mark = new long[block_size * 2];
+        memcpy(undo_mark, old_mark, block_size * sizeof(long));
+        block_size *= 2;
+        delete[] old_table;
+        delete[] old_mark;
+    }
     block_table[current_level] = sym_pos;
+    undo_mark[current_level] = undo_pos;
 }
 
 
-/* Decrease the current_level by one. Return sym_index to new environment. */
+/* Decrease the current_level by one. Return sym_index to new environment.
+   The undo log entries of the closed block are popped in reverse order, and
+   each symbol hands its hash table slot back to the symbol it shadowed.
+   Temporaries never entered the hash table, so they cost nothing here. */
 sym_index symbol_table::close_scope()
 {
     /* Your code here */
     
     //cout << "closing scope. Sym_pos: " << sym_pos << endl;
-    sym_index temp = sym_pos;
-    while(temp > block_table[current_level]){
-
-        symbol* s = sym_tab->get_symbol(temp);
-        if (hash_table[s->back_link] == temp)
-        {
-            hash_table[s->back_link] = s->hash_link;
-        }
+    while (undo_pos > undo_mark[current_level]) {
+        sym_index temp = undo_log[--undo_pos];
+        symbol* s = sym_table[temp];
+        hash_table[hash_find(s->id)].sym = s->hash_link;
         s->hash_link = NULL_SYM;
-
-        temp--;
     }
 
     block_table[current_level] = 0; //TODO: dafuq? Needed? fucks things up?
@@ -591,37 +961,12 @@ sym_index symbol_table::close_scope()
 
 /*** Main symbol table methods. ***/
 
-/* Return a sym_index to the sought symbol (or 0 if none was found), given
-   a string_pool index. Starts searching in the current block level and
-   follows hash links outwards. */
+/* Return a sym_index to the sought symbol (or NULL_SYM if none was found),
+   given a string_pool index. The hash table slot of a name always points at
+   its innermost visible symbol, so this is a single probe sequence. */
 sym_index symbol_table::lookup_symbol(const pool_index pool_p)
 {
-    /* Your code here */
-    //char *sec = pool_lookup(pool_p);
-    //cout << "lookup_symbol: " << sec << endl;
-
-    hash_index h = hash(pool_p);
-    sym_index temp = hash_table[h];
-
-    while( temp != NULL_SYM ){
-        //cout << "Temp: " << temp << endl;
-        symbol *s = get_symbol(temp);
-        if(strcmp(pool_lookup(s->id), pool_lookup(pool_p)) == 0)// s->id == pool_p)
-        {
-            return temp;
-        }
-
-        else{
-            temp = s->hash_link;
-        }
-
-    }
-
-    //print(2);
-
-    //cout << "inte bra.\n";
-
-    return NULL_SYM;
+    return hash_table[hash_find(pool_p)].sym;
 }
 
 
@@ -666,7 +1011,7 @@ sym_index symbol_table::get_symbol_type(const sym_index sym_p)
     if (sym_p == NULL_SYM) {
         return void_type;
     }
-    return sym_table[sym_p]->type;
+    return hot_type[sym_p];
 }
 
 
@@ -680,7 +1025,84 @@ sym_type symbol_table::get_symbol_tag(const sym_index sym_p)
         return SYM_UNDEF;
     }
 
-    return sym_table[sym_p]->tag;
+    return hot_tag[sym_p];
+}
+
+
+/* The block level of a symbol. Read from the hot field table. */
+block_level symbol_table::get_symbol_level(const sym_index sym_p)
+{
+    return hot_level[sym_p];
+}
+
+
+/* The offset of a symbol in its activation record or parameter list. Read
+   from the hot field table. */
+int symbol_table::get_symbol_offset(const sym_index sym_p)
+{
+    return hot_offset[sym_p];
+}
+
+
+/* The nr of bytes a symbol takes up: the size of a variable, parameter or
+   constant, the size of a whole array, or the activation record size of a
+   function or procedure. Read from the hot field table. */
+int symbol_table::get_symbol_size(const sym_index sym_p)
+{
+    return hot_size[sym_p];
+}
+
+
+/* Allocate the hot field table for the given nr of symbols. */
+void symbol_table::hot_alloc(const sym_index size)
+{
+    hot_tag = new sym_type[size];
+    hot_type = new sym_index[size];
+    hot_level = new block_level[size];
+    hot_offset = new int[size];
+    hot_size = new int[size];
+}
+
+
+/* Copy the hot fields of a symbol into the hot field table. This must be
+   done whenever one of them changes, which the enter_* methods and
+   set_symbol_type() take care of. */
+void symbol_table::sync_hot(const sym_index sym_p)
+{
+    symbol *s = sym_table[sym_p];
+    int size = 0;
+
+    switch (s->tag) {
+    case SYM_VAR:
+    case SYM_PARAM:
+    case SYM_CONST:
+        if (s->type == integer_type || s->type == real_type) {
+            size = get_size(s->type);
+        }
+        break;
+    case SYM_ARRAY: {
+        array_symbol *arr = s->get_array_symbol();
+        if (arr->array_cardinality != ILLEGAL_ARRAY_CARD &&
+                (arr->type == integer_type || arr->type == real_type)) {
+            size = arr->array_cardinality * get_size(arr->type);
+        }
+        break;
+    }
+    case SYM_FUNC:
+        size = s->get_function_symbol()->ar_size;
+        break;
+    case SYM_PROC:
+        size = s->get_procedure_symbol()->ar_size;
+        break;
+    default:
+        break;
+    }
+
+    hot_tag[sym_p] = s->tag;
+    hot_type[sym_p] = s->type;
+    hot_level[sym_p] = s->level;
+    hot_offset[sym_p] = s->offset;
+    hot_size[sym_p] = size;
 }
 
 
@@ -696,6 +1118,36 @@ void symbol_table::set_symbol_type(const sym_index sym_p,
     }
 
     sym_table[sym_p]->type = type_p;
+    sync_hot(sym_p);
+}
+
+
+/* Move a variable to another offset in its activation record. Used by the
+   quad optimizer when it packs the temporaries that are still used. */
+void symbol_table::set_symbol_offset(const sym_index sym_p, const int offset)
+{
+    if (sym_p == NULL_SYM) {
+        return;
+    }
+
+    sym_table[sym_p]->offset = offset;
+    sync_hot(sym_p);
+}
+
+
+/* Set the activation record size of a procedure or function. */
+void symbol_table::set_ar_size(const sym_index sym_p, const int size)
+{
+    symbol *s = sym_table[sym_p];
+
+    if (s->tag == SYM_FUNC) {
+        s->get_function_symbol()->ar_size = size;
+    } else if (s->tag == SYM_PROC) {
+        s->get_procedure_symbol()->ar_size = size;
+    } else {
+        fatal("symbol_table::set_ar_size() called for non-proc/func");
+    }
+    sync_hot(sym_p);
 }
 
 
@@ -706,86 +1158,127 @@ void symbol_table::set_symbol_type(const sym_index sym_p,
    The parameter 'tag' can have one of eight different types, see the file symtabb.hh
    for the type definition of sym_type.
    Remember that the attribute 'tag' and 'id' will be set when creating
-   a new symbol inside the symbol constructor (take a look at symbol.cc).*/
+   a new symbol inside the symbol constructor (take a look at symbol.cc).
+   A new symbol takes over the hash table slot of its name, and is pushed
+   on the undo log so close_scope() can hand the slot back. */
 
 sym_index symbol_table::install_symbol(const pool_index pool_p,
                                        const sym_type tag)
 {
-    /* Your code here */
-    //cout << "\nInstall symbol. Sym_pos before: " << sym_pos << endl;   
-
-    sym_index harald = this->lookup_symbol(pool_p);
-    
-    //cout << " Looked up sym. Sym_index: " << harald << endl;
-    //cout << "Current level: " << current_level << endl;
-    symbol* s;
-    if(harald == NULL_SYM || get_symbol(harald)->level < current_level){
-        sym_pos++;
-        if (sym_pos >= MAX_SYM)
-            fatal("Symbol table full!");
-
-        switch( tag ){
-            
-            case SYM_ARRAY:
-                s = new array_symbol(pool_p);
-                break;
-
-            case SYM_FUNC:
-                s = new function_symbol(pool_p);
-                break;
-            
-            case SYM_PROC:
-                s = new procedure_symbol(pool_p);
-                
-                break;
-            
-            case SYM_VAR:
-                s = new variable_symbol(pool_p);
-                break;
-            
-            case SYM_PARAM:
-                s = new parameter_symbol(pool_p);
-                break;
-            
-            case SYM_CONST:
-                s = new constant_symbol(pool_p);
-                break;
-            
-            case SYM_NAMETYPE:
-                s = new nametype_symbol(pool_p);
-                break;
-            
-            default:
-                //s = new function_symbol(pool_p);
-                cout << "SYM TAG DEFAULT ?? dafuq\n";
-                break;
-        }
-        //cout << "s->id:  " << s->id << "\n";
-
-        
-        s->level = current_level;
-
+    // Grow before probing, so the slot we find stays valid. Keep the load
+    // factor at or below one half.
+    if (2 * (hash_count + 1) > hash_size) {
+        hash_grow();
+    }
+    hash_index slot = hash_find(pool_p);
+    sym_index harald = hash_table[slot].sym;
 
-        hash_index hash = this->hash(pool_p);
+    if (harald != NULL_SYM && get_symbol(harald)->level >= current_level) {
+        return harald;
+    }
 
+    sym_index sym_p = new_symbol(pool_p, tag);
+    symbol *s = sym_table[sym_p];
 
-        s->hash_link = hash_table[hash];
-        s->back_link = hash;
+    if (hash_table[slot].id == NULL_POOL) {
+        hash_table[slot].id = pool_p;
+        hash_count++;
+    }
+    s->hash_link = harald;
+    hash_table[slot].sym = sym_p;
+
+    // Log the change so close_scope() can undo it.
+    if (undo_pos >= undo_size) {
+        sym_index *old_log = undo_log;
+        undo_log = new sym_index[undo_size * 2];
+        memcpy(undo_log, old_log, undo_size * sizeof(sym_index));
+        undo_size *= 2;
+        delete[] old_log;
+    }
+    undo_log[undo_pos++] = sym_p;
 
-        //cout << "ayy: " << s->hash_link << "\n" << s->back_link << "\n";
+    return sym_p;
+}
 
-        
-        this->hash_table[hash] = sym_pos;
-        this->sym_table[sym_pos] = s;
 
-        
-        return sym_pos;
+/* Create a symbol of the right subclass and put it at the end of the symbol
+   table, without making it visible in the hash table. install_symbol() uses
+   this for named symbols, and gen_temp_var() uses it directly, since
+   temporaries are never looked up by name. */
+sym_index symbol_table::new_symbol(const pool_index pool_p,
+                                   const sym_type tag)
+{
+    sym_pos++;
+    if (sym_pos >= sym_size) {
+        symbol **old_table = sym_table;
+        sym_table = new symbol*[sym_size * 2];
+        memcpy(sym_table, old_table, sym_size * sizeof(symbol *));
+        for (sym_index i = sym_size; i < sym_size * 2; i++) {
+            sym_table[i] = NULL;
+        }
+        delete[] old_table;
+
+        // The hot field table grows along with it.
+        sym_type *old_tag = hot_tag;
+        sym_index *old_type = hot_type;
+        block_level *old_level = hot_level;
+        int *old_offset = hot_offset;
+        int *old_size = hot_size;
+        hot_alloc(sym_size * 2);
+        memcpy(hot_tag, old_tag, sym_size * sizeof(sym_type));
+        memcpy(hot_type, old_type, sym_size * sizeof(sym_index));
+        memcpy(hot_level, old_level, sym_size * sizeof(block_level));
+        memcpy(hot_offset, old_offset, sym_size * sizeof(int));
+        memcpy(hot_size, old_size, sym_size * sizeof(int));
+        delete[] old_tag;
+        delete[] old_type;
+        delete[] old_level;
+        delete[] old_offset;
+        delete[] old_size;
+
+        sym_size *= 2;
     }
-    else{
 
-        return harald;
-    
+    symbol *s = NULL;
+    switch (tag) {
+    case SYM_ARRAY:
+        s = new (arena.allocate(sizeof(array_symbol))) array_symbol(pool_p);
+        break;
+    case SYM_FUNC:
+        s = new (arena.allocate(sizeof(function_symbol)))
+            function_symbol(pool_p);
+        break;
+    case SYM_PROC:
+        s = new (arena.allocate(sizeof(procedure_symbol)))
+            procedure_symbol(pool_p);
+        break;
+    case SYM_VAR:
+        s = new (arena.allocate(sizeof(variable_symbol)))
+            variable_symbol(pool_p);
+        break;
+    case SYM_PARAM:
+        s = new (arena.allocate(sizeof(parameter_symbol)))
+            parameter_symbol(pool_p);
+        break;
+    case SYM_CONST:
+        s = new (arena.allocate(sizeof(constant_symbol)))
+            constant_symbol(pool_p);
+        break;
+    case SYM_NAMETYPE:
+        s = new (arena.allocate(sizeof(nametype_symbol)))
+            nametype_symbol(pool_p);
+        break;
+    default:
+        fatal("symbol_table::new_symbol: Illegal symbol tag");
+        break;
     }
+
+    s->level = current_level;
+    s->back_link = hash(pool_p) & (hash_size - 1);
+    sym_table[sym_pos] = s;
+    sync_hot(sym_pos);
+
+    return sym_pos;
 }
 
 /* Enter a constant into the symbol table. The value is an integer. The type
@@ -793,7 +1286,7 @@ sym_index symbol_table::install_symbol(const pool_index pool_p,
    This function is used from within parser.y. Currently we call using the
    field data instead of a symbol, since we're not keeping position information
    in the *_symbol classes at the moment. */
-sym_index symbol_table::enter_constant(position_information *pos,
+sym_index symbol_table::enter_constant(position_information pos,
                                        const pool_index pool_p,
                                        const sym_index type,
                                        const long ival)
@@ -815,6 +1308,7 @@ sym_index symbol_table::enter_constant(position_information *pos,
 
     con->const_value.ival = ival;
     sym_table[sym_p] = con;
+    sync_hot(sym_p);
 
     return sym_p;
 }
@@ -825,7 +1319,7 @@ sym_index symbol_table::enter_constant(position_information *pos,
    This function is used from within parser.y. Currently we call using the
    field data instead of a symbol, since we're not keeping position information
    in the *_symbol classes at the moment. */
-sym_index symbol_table::enter_constant(position_information *pos,
+sym_index symbol_table::enter_constant(position_information pos,
                                        const pool_index pool_p,
                                        const sym_index type,
                                        const double rval)
@@ -853,6 +1347,7 @@ sym_index symbol_table::enter_constant(position_information *pos,
     con->const_value.rval = rval;
 
     sym_table[sym_p] = con;
+    sync_hot(sym_p);
 
     return sym_p;
 }
@@ -860,13 +1355,22 @@ sym_index symbol_table::enter_constant(position_information *pos,
 
 /* Enter a variable into the symbol table. This function is used from within
    parser.y. */
-sym_index symbol_table::enter_variable(position_information *pos,
+sym_index symbol_table::enter_variable(position_information pos,
                                        const pool_index pool_p,
                                        const sym_index type)
 {
     // Install a variable_symbol in the symbol table.
-    sym_index sym_p = install_symbol(pool_p, SYM_VAR);
+    return setup_variable(pos, install_symbol(pool_p, SYM_VAR), type);
+}
+
 
+/* Set up the variable specific fields of a freshly installed variable and
+   allocate room for it in the current activation record. Shared between the
+   two enter_variable() methods. */
+sym_index symbol_table::setup_variable(position_information pos,
+                                       const sym_index sym_p,
+                                       const sym_index type)
+{
     // This extra mess is required for safe downcasting, so we can access
     // the fields specific to this subclass of symbol.
     symbol *tmp = sym_table[sym_p];
@@ -912,16 +1416,21 @@ sym_index symbol_table::enter_variable(position_information *pos,
     }
 
     sym_table[sym_p] = var;
+    sync_hot(sym_p);
+    sync_hot(current_environment());
 
     return sym_p;
 }
 
 
 /* Convenience method used by quads.cc when installing temporary variables.
-   Position information is irrelevant in that case. */
+   Position information is irrelevant in that case. Temporaries have unique
+   names that can't be written in Diesel, so they are never looked up and
+   are kept out of the hash table. */
 sym_index symbol_table::enter_variable(pool_index pool_p, sym_index type)
 {
-    return enter_variable(NULL, pool_p, type);
+    return setup_variable(position_information::unknown(),
+                          new_symbol(pool_p, SYM_VAR), type);
 }
 
 
@@ -929,7 +1438,7 @@ sym_index symbol_table::enter_variable(pool_index pool_p, sym_index type)
    NOTE: We currently assume that parser.y only allows integer index types.
    If that part's changed, we'll need to pass the type of the index as an
    argument to this function as well. */
-sym_index symbol_table::enter_array(position_information *pos,
+sym_index symbol_table::enter_array(position_information pos,
                                     const pool_index pool_p,
                                     const sym_index type,
                                     const int cardinality)
@@ -982,12 +1491,14 @@ sym_index symbol_table::enter_array(position_information *pos,
         }
     }
     sym_table[sym_p] = arr;
+    sync_hot(sym_p);
+    sync_hot(current_environment());
     return sym_p;
 }
 
 
 /* Enter a function_symbol into the symbol table. */
-sym_index symbol_table::enter_function(position_information *pos,
+sym_index symbol_table::enter_function(position_information pos,
                                        const pool_index pool_p)
 {
     // Install a function_symbol in the symbol table.
@@ -1016,13 +1527,14 @@ sym_index symbol_table::enter_function(position_information *pos,
     func->label_nr = get_next_label();
 
     sym_table[sym_p] = func;
+    sync_hot(sym_p);
 
     return sym_p;
 }
 
 
 /* Enter a procedure_symbol into the symbol table. */
-sym_index symbol_table::enter_procedure(position_information *pos,
+sym_index symbol_table::enter_procedure(position_information pos,
                                         const pool_index pool_p)
 {
     /* Your code here */
@@ -1047,6 +1559,7 @@ sym_index symbol_table::enter_procedure(position_information *pos,
     proc->label_nr = get_next_label();
 
     sym_table[i] = proc;
+    sync_hot(i);
 
     //cout << "\n\n\n\n";
     //print(1);
@@ -1057,7 +1570,7 @@ sym_index symbol_table::enter_procedure(position_information *pos,
 
 
 /* Enter a parameter into the symbol table. */
-sym_index symbol_table::enter_parameter(position_information *pos,
+sym_index symbol_table::enter_parameter(position_information pos,
                                         const pool_index pool_p,
                                         const sym_index type)
 {
@@ -1119,6 +1632,7 @@ sym_index symbol_table::enter_parameter(position_information *pos,
     par->type = type;
 
     sym_table[sym_p] = par;
+    sync_hot(sym_p);
 
     return sym_p;
 }
@@ -1129,7 +1643,7 @@ sym_index symbol_table::enter_parameter(position_information *pos,
    table, but in a language where you can define new types, this function is
    needed. So we prepare Diesel for expanding, even if this function
    currently doesn't do any spectacular things. :) */
-sym_index symbol_table::enter_nametype(position_information *pos,
+sym_index symbol_table::enter_nametype(position_information pos,
                                        const pool_index pool_p)
 {
     // Install a nametype_symbol in the symbol table.
@@ -1143,6 +1657,7 @@ sym_index symbol_table::enter_nametype(position_information *pos,
     // Set up the nametype-specific fields.
     sym_table[sym_p]->tag = SYM_NAMETYPE;
     sym_table[sym_p]->type = void_type;
+    sync_hot(sym_p);
 
     return sym_p;
 }
@@ -36,21 +36,34 @@ typedef enum symbol_types sym_type;
 
 /* Some numerical constants we use in the symbol table. */
 
-// Max allowed nesting levels.
-const block_level MAX_BLOCK = 8;
+// Base size of the display, ie, nesting levels before it has to grow.
+const block_level BASE_BLOCK_SIZE = 8;
 
-// Max size of hash table.
-const hash_index MAX_HASH = 512;
+// Base size of the symbol hash table. Must be a power of two.
+const hash_index BASE_HASH_SIZE = 512;
 
 // Base size of string pool.
 const pool_index BASE_POOL_SIZE = 1024;
 
-// Max size of symbol table.
-const sym_index MAX_SYM = 1024;
+// Bytes in front of every string pool entry: one length byte followed by the
+// entry's cached hash value.
+const int POOL_HEADER_SIZE = 1 + sizeof(unsigned int);
+
+// Base size of the string intern table. Must be a power of two.
+const long BASE_INTERN_SIZE = 512;
+
+// Base size of symbol table.
+const sym_index BASE_SYM_SIZE = 1024;
+
+// Size of the chunks a memory arena hands out memory from.
+const long ARENA_CHUNK_SIZE = 64 * 1024;
 
 // Signifies 'no symbol'.
 const sym_index NULL_SYM = -1;
 
+// Signifies 'no string', ie, an empty slot in the string intern table.
+const pool_index NULL_POOL = -1;
+
 // Signifies a non-int array size.
 const int ILLEGAL_ARRAY_CARD = -1;
 
@@ -125,10 +138,12 @@ public:
     // Type: integer_type, real_type, or void_type.
     sym_index type;
 
-    // Link to other symbols with same hash key.
+    // Link to the symbol with the same name that this one shadows, ie, the
+    // one that becomes visible again when this one's scope is closed.
     sym_index hash_link;
 
-    // Link back to the hash table.
+    // Home slot of the name in the hash table when the symbol was installed.
+    // The table may have grown since, so this is only informative.
     sym_index back_link;
 
     // Current block level, ie, nesting depth.
@@ -358,6 +373,63 @@ ostream &operator<<(ostream &, symbol *);
 
 
 
+/******************************
+ *** THE MEMORY ARENA CLASS ***
+ ******************************/
+
+/* A bump allocator for objects that are never freed one at a time. Symbols
+   live as long as the symbol table, and AST nodes as long as the block they
+   belong to, so there is no point in paying for a separate heap allocation
+   per object. The arena hands out memory from big chunks, so objects
+   created together also end up next to each other. Use it with placement
+   new:
+       s = new (arena.allocate(sizeof(variable_symbol))) variable_symbol(p);
+   The objects must not have destructors with side effects, since release()
+   simply throws away all chunks at once. */
+class memory_arena
+{
+private:
+    // A chunk starts with a link to the previous chunk. The objects follow.
+    struct chunk {
+        chunk *prev;
+    };
+
+    // The chunk currently being filled, or NULL.
+    chunk *current;
+
+    // Next free byte in the current chunk, and the end of it.
+    char *next;
+    char *limit;
+
+    // Link in a new chunk with room for at least the given nr of bytes.
+    void new_chunk(long);
+
+public:
+    memory_arena();
+    ~memory_arena();
+
+    // Return memory for an object of the given size, suitably aligned.
+    void *allocate(long);
+
+    // Free everything allocated from the arena in one go.
+    void release();
+};
+
+
+/* Block arenas. The AST nodes and position information of a block are
+   allocated from an arena of their own, see ast.hh. parser.y pushes a new
+   arena when it starts on a procedure, function or the program, and pops it
+   when the block has been compiled, which frees all of its nodes at once.
+   Allocations made while no arena is pushed go to the heap. */
+void push_block_arena();
+
+void pop_block_arena();
+
+void *block_allocate(size_t);
+
+
+
+
 /******************************
  *** THE SYMBOL TABLE CLASS ***
  ******************************/
@@ -378,6 +450,19 @@ ostream &operator<<(ostream &, symbol *);
             }
             ;
 */
+/* A slot in the symbol hash table. Every name that has ever been installed
+   as a symbol owns one slot, which points at the innermost visible symbol
+   with that name. Shadowed symbols are reached through their hash_link.
+   Since the string pool is interned a name is identified by its pool_index
+   alone. */
+struct hash_slot {
+    // The name, or NULL_POOL if the slot is empty.
+    pool_index id;
+
+    // The visible symbol with this name, or NULL_SYM if there is none.
+    sym_index sym;
+};
+
 class symbol_table
 {
 private:
@@ -392,10 +477,43 @@ private:
     // Points to end of string pool
     long pool_pos;
 
+    // The intern table. An open addressing hash table of pool_indexes which
+    // makes sure every distinct string is only installed in the pool once.
+    pool_index *intern_table;
+
+    // Size of the intern table, always a power of two.
+    long intern_size;
+
+    // Nr of strings in the intern table.
+    long intern_count;
+
+    // Find the intern table slot holding a string, or the empty slot where
+    // it should go. Args: string, length, hash value.
+    long intern_slot(const char *, int, unsigned int);
+
+    // Double the size of the intern table.
+    void intern_grow();
+
+    // Install a string whose hash value is already known. Args: string,
+    // length, hash value.
+    pool_index pool_install(const char *, int, unsigned int);
+
     // --- Hash table variables. ---
 
-    // The actual hash table.
-    sym_index *hash_table;
+    // The actual hash table. Open addressing with linear probing.
+    hash_slot *hash_table;
+
+    // Size of the hash table, always a power of two.
+    hash_index hash_size;
+
+    // Nr of used slots in the hash table.
+    hash_index hash_count;
+
+    // Find the slot holding a name, or the empty slot where it should go.
+    hash_index hash_find(const pool_index);
+
+    // Double the size of the hash table.
+    void hash_grow();
 
     // --- Display variables. ---
 
@@ -406,14 +524,59 @@ private:
     // the start of a new scope/block.
     sym_index *block_table;
 
+    // Allocated size of the block_table (and of undo_mark).
+    block_level block_size;
+
+    // The undo log. Every symbol that install_symbol() enters in the hash
+    // table is pushed here, so close_scope() only has to visit those.
+    sym_index *undo_log;
+
+    // Allocated size of, and next free position in, the undo log.
+    long undo_size;
+    long undo_pos;
+
+    // Position of the undo log when each block level was opened.
+    long *undo_mark;
+
     // --- Symbol table variables. ---
 
     // The actual symbol table.
     symbol **sym_table;
 
+    // Allocated size of the sym_table.
+    sym_index sym_size;
+
+    // --- Hot symbol fields. ---
+
+    // Copies of the symbol fields that the later passes read all the time,
+    // as parallel arrays indexed by sym_index. Reading them doesn't touch
+    // the symbol objects themselves. Use the get_symbol_* methods.
+    sym_type *hot_tag;
+    sym_index *hot_type;
+    block_level *hot_level;
+    int *hot_offset;
+    int *hot_size;
+
+    // Allocate the hot field arrays for the given nr of symbols.
+    void hot_alloc(const sym_index);
+
+    // Copy the hot fields of a symbol into the arrays above.
+    void sync_hot(const sym_index);
+
     // Points to last symbol entered in the table.
     sym_index sym_pos;
 
+    // All symbols are allocated from here.
+    memory_arena arena;
+
+    // Create a symbol and add it to the symbol table, but not to the hash
+    // table.
+    sym_index new_symbol(const pool_index, const sym_type);
+
+    // Fill in a newly installed variable. Used by enter_variable().
+    sym_index setup_variable(position_information, const sym_index,
+                             const sym_index);
+
     // Assembler label counter.
     int label_nr;
 
@@ -435,12 +598,28 @@ public:
 
     // --- String pool methods. ---
 
-    // Install a string in the pool.
-    pool_index pool_install(char *);
+    // Install a string in the pool. Equal strings share one pool_index.
+    pool_index pool_install(const char *);
+
+    // Install a string given as a pointer and a length.
+    pool_index pool_install(const char *, int);
+
+    // Install an upper case copy of a string given as a pointer and a
+    // length. Doesn't allocate anything for strings already in the pool.
+    pool_index pool_install_upper(const char *, int);
 
-    char *pool_lookup(const pool_index);
+    // Return a pooled string. No copy is made, the pointer points straight
+    // into the pool and stays valid until the next pool_install().
+    const char *pool_lookup(const pool_index);
 
-     // Compare strings
+    // Return the length of a pooled string.
+    int pool_strlen(const pool_index);
+
+    // Return the hash value computed for a string when it was installed.
+    unsigned int pool_hash(const pool_index);
+
+    // Compare strings. Since the pool is interned this is just an index
+    // comparison.
     bool pool_compare(const pool_index, const pool_index);
 
     // Remove last entry from  string pool.
@@ -485,10 +664,24 @@ public:
 
     sym_type get_symbol_tag(const sym_index);
 
+    // Block level, offset and byte size of a symbol. Like get_symbol_type()
+    // and get_symbol_tag() these read the hot field table.
+    block_level get_symbol_level(const sym_index);
+
+    int get_symbol_offset(const sym_index);
+
+    int get_symbol_size(const sym_index);
+
     // Set the type of a symbol (void_type, integer_type, or real_type).
     // Args: Index to the symbol to be changed, index to the type symbol.
     void set_symbol_type(const sym_index, const sym_index);
 
+    // Set the offset of a variable, and the activation record size of a
+    // procedure or function. Used by the quad optimizer, see quadopt.cc.
+    void set_symbol_offset(const sym_index, const int);
+
+    void set_ar_size(const sym_index, const int);
+
     // These two methods are used in quads.cc.
 
     // Generate next asm label.
@@ -503,18 +696,18 @@ public:
     // Args: Position information, identifier, type pointer, value. Note that
     // the value can either be an long or a double, and therefore there are two
     // versions of this method.
-    sym_index enter_constant(position_information *,
+    sym_index enter_constant(position_information,
                              const pool_index,
                              const sym_index,
                              const long);
 
-    sym_index enter_constant(position_information *,
+    sym_index enter_constant(position_information,
                              const pool_index,
                              const sym_index,
                              const double);
 
     // Args: Position information, identifier, type pointer.
-    sym_index enter_variable(position_information *,
+    sym_index enter_variable(position_information,
                              const pool_index,
                              const sym_index);
 
@@ -524,23 +717,23 @@ public:
 
     // Args: Position information, identifier, array type pointer,
     //       index type pointer, cardinality.
-    sym_index enter_array(position_information *,
+    sym_index enter_array(position_information,
                           const pool_index,
                           const sym_index,
                           const int);
 
     // Args: Position information, identifier.
-    sym_index enter_function(position_information *, const pool_index);
+    sym_index enter_function(position_information, const pool_index);
 
-    sym_index enter_procedure(position_information *, const pool_index);
+    sym_index enter_procedure(position_information, const pool_index);
 
     // Args: Position information, identifier, type pointer.
-    sym_index enter_parameter(position_information *,
+    sym_index enter_parameter(position_information,
                               const pool_index,
                               const sym_index);
 
     // Args: Position information, identifier. NOTE: Maybe should be private?
-    sym_index enter_nametype(position_information *, const pool_index);
+    sym_index enter_nametype(position_information, const pool_index);
 };
 
 
@@ -1,9 +1,14 @@
 #include <iostream>
 #include <iomanip>
+#include <string>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "symtab.hh"
 #include "scanner.hh"
+#include "alloccount.hh"
 
 using namespace std;
 
@@ -151,6 +156,147 @@ const Omanip_int Token(int t)
 /* Magic part ends here. */
 
 
+/*** Benchmark mode. ***/
+
+/* With -b the scanner doesn't print anything. Instead it scans a corpus a
+   number of times and reports the throughput. The corpus is made up of the
+   files given on the command line and/or a synthetic Diesel program of the
+   size given with -g. */
+
+/* The parts of the flex interface we need to scan from memory. */
+struct yy_buffer_state;
+typedef struct yy_buffer_state *YY_BUFFER_STATE;
+extern YY_BUFFER_STATE yy_scan_buffer(char *, size_t);
+extern void yy_delete_buffer(YY_BUFFER_STATE);
+extern int yylineno;
+
+
+/* Append the contents of a file to the corpus. */
+static void read_corpus_file(string &corpus, const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        perror(filename);
+        exit(1);
+    }
+
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        corpus.append(buf, n);
+    }
+    fclose(f);
+}
+
+
+/* Append a synthetic Diesel program of about the given nr of bytes to the
+   corpus. It is a long list of procedures using a few hundred different
+   identifiers, with the usual mix of keywords, numbers, reals, strings,
+   comments and operators. A fixed seed makes the output the same every
+   time. */
+static void generate_corpus(string &corpus, long size)
+{
+    unsigned long seed = 4711;
+    char line[1024];
+    long start = corpus.size();
+
+    corpus += "program synthetic;\n";
+    long proc_nr = 0;
+    while ((long) corpus.size() - start < size) {
+        seed = seed * 1103515245 + 12345;
+        int a = (seed >> 8) % 300;
+        int b = (seed >> 16) % 300;
+        int c = (seed >> 24) % 1000;
+
+        sprintf(line,
+                "{ procedure %ld }\n"
+                "procedure Proc_%ld(param%d : integer; x_%d : real);\n"
+                "const\n    LIMIT%d = %d;\n"
+                "var\n    counter_%d : integer;\n"
+                "    buffer : array[%d] of real;\n"
+                "begin\n"
+                "    counter_%d := param%d * %d + LIMIT%d div 7;\n"
+                "    while (counter_%d > 0) and not (x_%d = %d.%de-3) do\n"
+                "        buffer[counter_%d mod 10] := x_%d / 2.5;\n"
+                "        counter_%d := counter_%d - 1;\n"
+                "    end;\n"
+                "    if x_%d <> 0.%d then\n"
+                "        write('value ''%d'' done');\n"
+                "    elsif param%d < %d then\n"
+                "        return;\n"
+                "    end;\n"
+                "end;\n\n",
+                proc_nr, proc_nr, a, b, c, c, a, c + 1,
+                a, a, c, c, a, b, c, b % 10, a, b, a, a,
+                b, c, c, a, c);
+        corpus += line;
+        proc_nr++;
+    }
+    corpus += "begin\nend.\n";
+}
+
+
+/* Scan the corpus the given nr of times and print the results. */
+static int benchmark(string &corpus, int repeats)
+{
+    extern int yylex();
+
+    // flex wants the buffer to end with two null chars. It only changes
+    // the buffer while a token is being matched and puts back what it
+    // changed, so one copy can be rescanned every round. The copy is made
+    // before the clock starts.
+    size_t length = corpus.size();
+    char *buffer = new char[length + 2];
+    memcpy(buffer, corpus.data(), length);
+    buffer[length] = '\0';
+    buffer[length + 1] = '\0';
+
+    long nr_tokens = 0;
+    long start_allocs = nr_allocs;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (int r = 0; r < repeats; r++) {
+        yylineno = 1;
+        YY_BUFFER_STATE state = yy_scan_buffer(buffer, length + 2);
+        while (yylex() != 0) {
+            nr_tokens++;
+        }
+        yy_delete_buffer(state);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    long allocs = nr_allocs - start_allocs;
+    double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    double megabytes = (double) length * repeats / (1024 * 1024);
+
+    cout << "Scanned " << repeats << " x " << length << " bytes, "
+         << nr_tokens << " tokens in " << fixed << setprecision(3)
+         << seconds << " s\n"
+         << "  tokens/sec:   " << setprecision(0) << nr_tokens / seconds << '\n'
+         << "  MB/sec:       " << setprecision(1) << megabytes / seconds << '\n'
+         << "  allocs/token: " << setprecision(4)
+         << (nr_tokens > 0 ? (double) allocs / nr_tokens : 0.0) << '\n';
+
+    delete[] buffer;
+    return 0;
+}
+
+
+static void usage(char *program_name)
+{
+    cerr << "Usage:\n"
+         << program_name << " [ filename ]\n"
+         << program_name << " -b [-r repeats] [-g megabytes] [ filename ... ]\n"
+         << "Options:\n"
+         << "  -b                Benchmark mode, only print throughput.\n"
+         << "  -r repeats        Scan the corpus this many times (default 10).\n"
+         << "  -g megabytes      Add a synthetic Diesel program of this size\n"
+         << "                    to the corpus (default 4 if no files given).\n";
+    exit(1);
+}
+
+
 /* Interactive scanner. We just parse whatever is typed in, and the token
    type and corresponding yytext is printed. */
 int main(int argc, char **argv)
@@ -159,21 +305,59 @@ int main(int argc, char **argv)
     extern  FILE *yyin;
     extern  int yylex();
 
+    bool bench = false;
+    int repeats = 10;
+    double generate_mb = 0;
+    int option;
+
+    opterr = 0;
+    while ((option = getopt(argc, argv, "br:g:")) != EOF) {
+        switch (option) {
+        case 'b':
+            bench = true;
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        case 'g':
+            generate_mb = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (bench) {
+        string corpus;
+        for (int i = optind; i < argc; i++) {
+            read_corpus_file(corpus, argv[i]);
+        }
+        if (optind == argc && generate_mb == 0) {
+            generate_mb = 4;
+        }
+        if (generate_mb > 0) {
+            generate_corpus(corpus, (long) (generate_mb * 1024 * 1024));
+        }
+        if (repeats < 1 || corpus.empty()) {
+            usage(argv[0]);
+        }
+        return benchmark(corpus, repeats);
+    }
+
     /* Open the input file, if any. */
-    switch (argc) {
-    case 1:
+    switch (argc - optind) {
+    case 0:
         yyin = stdin;
         break;
-    case 2:
-        yyin = fopen(argv[1], "r");
+    case 1:
+        yyin = fopen(argv[optind], "r");
         if (yyin == NULL) {
-            perror(argv[1]);
+            perror(argv[optind]);
             exit(1);
         }
         break;
     default:
-        cerr << "Usage: " << argv[0] << " [ filename ]\n";
-        exit(1);
+        usage(argv[0]);
     }
 
     /* Loop for as long as there are tokens */
@@ -0,0 +1 @@
+../remaining/alloccount.cc
\ No newline at end of file
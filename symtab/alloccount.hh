@@ -0,0 +1 @@
+../remaining/alloccount.hh
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "scanner.hh"
+#include "symtab.hh"
+#include "alloccount.hh"
+
+using namespace std;
+
+/* Benchmarks for the symbol table. Each workload runs against a fresh
+   symbol table and reports the time and the number of heap allocations per
+   operation. The identifier workloads report the bytes handled per cycle
+   instead of the allocations. Build with 'make symtabbench' and run the
+   binary, optionally with a scale factor as argument (default 1). */
+
+
+YYSTYPE yylval;
+YYLTYPE yylloc;
+
+
+/*** Measuring. ***/
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Start and stop a measurement. report() prints one line per workload. */
+static double start_time;
+static long start_allocs;
+
+static void start()
+{
+    start_allocs = nr_allocs;
+    start_time = now_ns();
+}
+
+static void report(const char *name, long ops)
+{
+    double ns = now_ns() - start_time;
+    long allocs = nr_allocs - start_allocs;
+    cout << left << setw(28) << name << right
+         << setw(10) << ops
+         << setw(12) << fixed << setprecision(1) << ns / ops
+         << setw(12) << setprecision(3) << (double) allocs / ops << endl;
+}
+
+/* Cycles from the time stamp counter, which ticks at a fixed reference
+   rate. Where there is none we fall back on nanoseconds. */
+static double now_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (double) __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+/* Like report(), but for workloads that walk strings. Prints the bytes
+   handled per cycle instead of the allocations. start_cycles is set by
+   start_bytes(). */
+static double start_cycles;
+
+static void start_bytes()
+{
+    start();
+    start_cycles = now_cycles();
+}
+
+static void report_bytes(const char *name, long ops, long bytes)
+{
+    double cycles = now_cycles() - start_cycles;
+    double ns = now_ns() - start_time;
+    cout << left << setw(28) << name << right
+         << setw(10) << ops
+         << setw(12) << fixed << setprecision(1) << ns / ops
+         << setw(12) << setprecision(3) << bytes / cycles << endl;
+}
+
+/* Start from an empty symbol table with only the predefined symbols. The old
+   one is leaked on purpose, the symbol table has no destructor. */
+static void fresh_table()
+{
+    sym_tab = new symbol_table();
+}
+
+
+/*** Name generation. ***/
+
+/* Write a name for i to buf, eg, "v123". */
+static void make_name(char *buf, const char *prefix, long i)
+{
+    sprintf(buf, "%s%ld", prefix, i);
+}
+
+/* Write a name of 2 * bits chars to buf, choosing between the pairs "Ab"
+   and "BA" by the bits of i. The two pairs have the same hash_x33 value, so
+   all names made from the same number of pairs hash to the same value. This
+   gives us as many colliding names as we want. */
+static void make_colliding_name(char *buf, long i, int bits)
+{
+    for (int b = 0; b < bits; b++) {
+        if (i & (1L << b)) {
+            buf[2 * b] = 'A';
+            buf[2 * b + 1] = 'b';
+        } else {
+            buf[2 * b] = 'B';
+            buf[2 * b + 1] = 'A';
+        }
+    }
+    buf[2 * bits] = '\0';
+}
+
+
+/*** The workloads. ***/
+
+/* Install n distinct strings, then install them all once more. The second
+   round only hits the intern table. */
+static void bench_pool(long n)
+{
+    char buf[32];
+
+    fresh_table();
+    start();
+    for (long i = 0; i < n; i++) {
+        make_name(buf, "V", i);
+        sym_tab->pool_install(buf);
+    }
+    report("pool_install (new)", n);
+
+    start();
+    for (long i = 0; i < n; i++) {
+        make_name(buf, "V", i);
+        sym_tab->pool_install(buf);
+    }
+    report("pool_install (existing)", n);
+}
+
+/* Install identifiers the way the scanner does, with pool_install_upper(),
+   and the way it used to, with capitalize() followed by pool_install(),
+   which hashes the copy. nr_names lower case identifiers of len chars are
+   installed first, and n installs then cycle through them, so this is the
+   common case of an identifier that is already in the pool. */
+static void bench_identifiers(long n, int len, const char *upper_name,
+                              const char *capitalize_name)
+{
+    const int nr_names = 1024;
+    char *names = new char[nr_names * (len + 1)];
+
+    fresh_table();
+    for (int i = 0; i < nr_names; i++) {
+        char *name = &names[i * (len + 1)];
+        int used = sprintf(name, "v%d", i);
+        memset(name + used, 'x', len - used);
+        name[len] = '\0';
+        sym_tab->pool_install_upper(name, len);
+    }
+
+    start_bytes();
+    for (long i = 0; i < n; i++) {
+        sym_tab->pool_install_upper(&names[(i % nr_names) * (len + 1)], len);
+    }
+    report_bytes(upper_name, n, n * len);
+
+    start_bytes();
+    for (long i = 0; i < n; i++) {
+        char *upper = sym_tab->capitalize(&names[(i % nr_names) * (len + 1)]);
+        sym_tab->pool_install(upper);
+        delete[] upper;
+    }
+    report_bytes(capitalize_name, n, n * len);
+
+    delete[] names;
+}
+
+/* Declare n distinct global variables, then look each one up. */
+static void bench_distinct(long n)
+{
+    char buf[32];
+    position_information pos;
+    pool_index *names = new pool_index[n];
+
+    fresh_table();
+    for (long i = 0; i < n; i++) {
+        make_name(buf, "V", i);
+        names[i] = sym_tab->pool_install(buf);
+    }
+
+    start();
+    for (long i = 0; i < n; i++) {
+        sym_tab->enter_variable(pos, names[i], integer_type);
+    }
+    report("install_symbol (distinct)", n);
+
+    start();
+    for (long i = 0; i < n; i++) {
+        if (sym_tab->lookup_symbol(names[i]) == NULL_SYM) {
+            fatal("symtabbench: lost a symbol");
+        }
+    }
+    report("lookup_symbol (distinct)", n);
+
+    delete[] names;
+}
+
+/* Nest depth procedures, each declaring the same few names, so every name is
+   shadowed depth times. Look the names up at the innermost level, then close
+   all the scopes again. */
+static void bench_shadowing(long depth)
+{
+    const int nr_names = 8;
+    char buf[32];
+    position_information pos;
+    pool_index names[nr_names];
+
+    fresh_table();
+    for (int j = 0; j < nr_names; j++) {
+        make_name(buf, "X", j);
+        names[j] = sym_tab->pool_install(buf);
+    }
+    pool_index proc_name = sym_tab->pool_install("P");
+
+    start();
+    for (long i = 0; i < depth; i++) {
+        sym_tab->enter_procedure(pos, proc_name);
+        sym_tab->open_scope();
+        for (int j = 0; j < nr_names; j++) {
+            sym_tab->enter_variable(pos, names[j], integer_type);
+        }
+    }
+    report("open_scope+install (shadow)", depth * (nr_names + 1));
+
+    long lookups = depth * nr_names;
+    start();
+    for (long i = 0; i < depth; i++) {
+        for (int j = 0; j < nr_names; j++) {
+            sym_tab->lookup_symbol(names[j]);
+        }
+    }
+    report("lookup_symbol (shadowed)", lookups);
+
+    start();
+    for (long i = 0; i < depth; i++) {
+        sym_tab->close_scope();
+    }
+    report("close_scope (shadow)", depth);
+}
+
+/* Declare 2^bits names which all have the same hash value, ie, the worst
+   case for the hash table, and look them up. */
+static void bench_collisions(int bits)
+{
+    long n = 1L << bits;
+    char buf[64];
+    position_information pos;
+    pool_index *names = new pool_index[n];
+
+    fresh_table();
+    for (long i = 0; i < n; i++) {
+        make_colliding_name(buf, i, bits);
+        names[i] = sym_tab->pool_install(buf);
+    }
+
+    start();
+    for (long i = 0; i < n; i++) {
+        sym_tab->enter_variable(pos, names[i], integer_type);
+    }
+    report("install_symbol (collide)", n);
+
+    start();
+    for (long i = 0; i < n; i++) {
+        sym_tab->lookup_symbol(names[i]);
+    }
+    report("lookup_symbol (collide)", n);
+
+    delete[] names;
+}
+
+/* Open blocks procedures in a row, each with temps temporaries, and close
+   them again. */
+static void bench_temps(long blocks, long temps)
+{
+    char buf[32];
+    position_information pos;
+
+    fresh_table();
+    start();
+    for (long i = 0; i < blocks; i++) {
+        make_name(buf, "P", i);
+        sym_tab->enter_procedure(pos, sym_tab->pool_install(buf));
+        sym_tab->open_scope();
+        for (long j = 0; j < temps; j++) {
+            sym_tab->gen_temp_var(integer_type);
+        }
+        sym_tab->close_scope();
+    }
+    report("gen_temp_var (temp blocks)", blocks * temps);
+
+    start();
+    for (long i = 0; i < blocks; i++) {
+        sym_tab->open_scope();
+        sym_tab->close_scope();
+    }
+    report("open+close_scope (empty)", blocks);
+}
+
+
+int main(int argc, char **argv)
+{
+    long scale = 1;
+    if (argc > 1) {
+        scale = atol(argv[1]);
+        if (scale < 1) {
+            cerr << "Usage: " << argv[0] << " [scale]\n";
+            return 1;
+        }
+    }
+
+    cout << left << setw(28) << "workload" << right
+         << setw(10) << "ops"
+         << setw(12) << "ns/op"
+         << setw(12) << "allocs/op" << endl;
+
+    bench_pool(100000 * scale);
+    bench_distinct(100000 * scale);
+    bench_shadowing(1000 * scale);
+    bench_collisions(12);
+    bench_temps(1000 * scale, 100);
+
+    cout << endl << left << setw(28) << "identifier" << right
+         << setw(10) << "ops"
+         << setw(12) << "ns/op"
+         << setw(12) << "bytes/cycle" << endl;
+
+    bench_identifiers(1000000 * scale, 6, "pool_install_upper (6)",
+                      "capitalize+install (6)");
+    bench_identifiers(1000000 * scale, 64, "pool_install_upper (64)",
+                      "capitalize+install (64)");
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "peak RSS: " << usage.ru_maxrss << " kB" << endl;
+
+    return 0;
+}
@@ -26,7 +26,7 @@ YYLTYPE yylloc;
 
 int main(int argc, char **argv) {
     // This is just a dummy position for the preinstalled functions.
-    position_information *pos = new position_information();
+    position_information pos;
 
     cout << "Starting symtabtest.cc...\n" << flush;
 